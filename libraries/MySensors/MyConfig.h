@@ -40,6 +40,11 @@
 // This will add even more to the size of the final sketch!
 //#define MY_DEBUG_VERBOSE_SIGNING
 
+// Times the stages of receiving a message (radio read, signature check, debug print, passing
+// it to the controller, receive() callback) into histograms. The controller requests them with
+// I_PROFILE, the sketch can print them with profilePrint().
+//#define MY_PROFILING
+
 // Enable this in sketch if you want to use TX(1), RX(0) as normal I/O pin
 //#define MY_DISABLED_SERIAL
 
@@ -71,6 +76,8 @@
 //#define MY_RADIO_NRF24
 //#define MY_RADIO_RFM69
 //#define MY_RS485
+// Simulated radio for running many nodes in one Linux process (see drivers/RadioSim)
+//#define MY_RADIO_SIM
 
 /**
  * @def MY_NODE_ID
@@ -91,6 +98,19 @@
 // Enables repeater functionality (relays messages from other nodes)
 // #define MY_REPEATER_FEATURE
 
+// Keeps the routing table of repeaters and gateways in RAM (256 bytes). Routing never reads
+// EEPROM, changes are written back MY_ROUTING_TABLE_SAVE_DELAY after the first change, before
+// reboot, or when the sketch calls transportSaveRoutes().
+//#define MY_RAM_ROUTING_TABLE_FEATURE
+
+/**
+ * @def MY_ROUTING_TABLE_SAVE_DELAY
+ * @brief Milliseconds to collect routing table changes before writing them to EEPROM.
+ */
+#ifndef MY_ROUTING_TABLE_SAVE_DELAY
+#define MY_ROUTING_TABLE_SAVE_DELAY 30000
+#endif
+
 /**
  * @def MY_SMART_SLEEP_WAIT_DURATION
  * @brief The wait period before going to sleep when using smartSleep-functions.
@@ -102,6 +122,123 @@
 #define MY_SMART_SLEEP_WAIT_DURATION 500
 #endif
 
+// Finds the parent, requests the node id and presents the node in the background (driven by
+// _process()) instead of blocking for 2 seconds per step. setup() and loop() start right away,
+// use isTransportReady() to know when messages reach the controller.
+//#define MY_ASYNC_TRANSPORT_FEATURE
+
+/**
+ * @def MY_TRANSPORT_RETRY_DELAY
+ * @brief Milliseconds between attempts to find a parent or get an id (MY_ASYNC_TRANSPORT_FEATURE).
+ */
+#ifndef MY_TRANSPORT_RETRY_DELAY
+#define MY_TRANSPORT_RETRY_DELAY 10000
+#endif
+
+// Enables a receive buffer between the radio driver and the message processing. Each _process()
+// pass empties the radio into the buffer and handles all buffered messages, so bursts from many
+// children are absorbed while the previous message is still being handled (e.g. printed to serial).
+//#define MY_RX_MESSAGE_BUFFER_FEATURE
+
+/**
+ * @def MY_RX_MESSAGE_BUFFER_SIZE
+ * @brief Number of frames the receive buffer can hold. Each frame takes 35 bytes of RAM.
+ */
+#ifndef MY_RX_MESSAGE_BUFFER_SIZE
+#define MY_RX_MESSAGE_BUFFER_SIZE 4
+#endif
+
+// Enables the outbound message queue. send() returns as soon as the message is queued and
+// _process() transmits it in the background (see sendAsync() and sendStatus()). present(),
+// request() and the other sends that wait for the radio first transmit what is queued.
+//#define MY_SEND_QUEUE_FEATURE
+
+/**
+ * @def MY_SEND_QUEUE_SIZE
+ * @brief Number of messages the outbound queue can hold. Each entry takes about 36 bytes of RAM.
+ */
+#ifndef MY_SEND_QUEUE_SIZE
+#define MY_SEND_QUEUE_SIZE 4
+#endif
+
+// Adds a sequence number after the payload of unsigned messages (when there is room) and drops
+// messages seen shortly before, i.e. retransmissions after a lost hardware ack. Nodes without
+// the feature are told apart by frame length, so this can be rolled out node by node. It needs
+// exact frame lengths: no encryption, or MY_RF24_ENCRYPTION_CCM. The padding of CBC mode hides
+// the sequence number of most messages. Nodes without an id send no sequence numbers.
+//#define MY_MESSAGE_SEQUENCE_FEATURE
+
+/**
+ * @def MY_SEQUENCE_WINDOW_SIZE
+ * @brief Number of senders whose recent sequence numbers are remembered, the least recently
+ * heard one is replaced. Each takes 7 bytes of RAM plus @ref MY_SEQUENCE_WINDOW_DEPTH.
+ */
+#ifndef MY_SEQUENCE_WINDOW_SIZE
+#define MY_SEQUENCE_WINDOW_SIZE 6
+#endif
+
+/**
+ * @def MY_SEQUENCE_WINDOW_DEPTH
+ * @brief Number of sequence numbers remembered per sender.
+ */
+#ifndef MY_SEQUENCE_WINDOW_DEPTH
+#define MY_SEQUENCE_WINDOW_DEPTH 4
+#endif
+
+/**
+ * @def MY_SEQUENCE_WINDOW_TIME
+ * @brief Milliseconds a message counts as duplicate of an earlier one (from the last message of
+ * that sender, older ones are forgotten).
+ */
+#ifndef MY_SEQUENCE_WINDOW_TIME
+#define MY_SEQUENCE_WINDOW_TIME 2000
+#endif
+
+// Counts frames sent to and received from each neighbor (ok, failed, radio retries, RSSI where
+// the radio measures it, relayed messages). The controller reads the table with I_LINK_STATS,
+// the node answers with one I_LINK_STATS_RESPONSE (LinkStats payload) per neighbor.
+//#define MY_LINK_STATS_FEATURE
+
+/**
+ * @def MY_LINK_STATS_SIZE
+ * @brief Number of neighbors tracked (12 bytes each). The least active one is replaced when full.
+ */
+#ifndef MY_LINK_STATS_SIZE
+#define MY_LINK_STATS_SIZE 8
+#endif
+
+/**
+ * @def MY_LINK_STATS_REPORT_INTERVAL
+ * @brief If defined, also send the table to the controller every this many milliseconds.
+ */
+//#define MY_LINK_STATS_REPORT_INTERVAL 3600000
+
+// Stores saveState() positions below MY_STATE_LOG_SLOTS in a wear-leveled log after the
+// sketch area of EEPROM, so frequently saved values (counters) spread their writes over
+// MY_STATE_LOG_SIZE bytes. loadState() is served from RAM (2 bytes per slot).
+//#define MY_STATE_LOG_FEATURE
+
+/**
+ * @def MY_STATE_LOG_SLOTS
+ * @brief Number of saveState() positions (from 0) kept in the log, at most 127.
+ */
+#ifndef MY_STATE_LOG_SLOTS
+#define MY_STATE_LOG_SLOTS 16
+#endif
+
+/**
+ * @def MY_STATE_LOG_SIZE
+ * @brief EEPROM bytes used by the log, two per record. The default fills up a 1 KB EEPROM
+ * (but for the last 2 bytes, which hold the MY_RF24_ENCRYPTION_CCM frame counter).
+ */
+#ifndef MY_STATE_LOG_SIZE
+	#if defined(MY_RF24_ENCRYPTION_CCM)
+		#define MY_STATE_LOG_SIZE 352
+	#else
+		#define MY_STATE_LOG_SIZE 354
+	#endif
+#endif
+
 /**********************************
 *  Over the air firmware updates
 ***********************************/
@@ -128,6 +265,34 @@
 #define MY_OTA_FLASH_JDECID 0x1F65
 #endif
 
+/**
+ * @def MY_OTA_WINDOW_SIZE
+ * @brief Number of firmware blocks requested ahead of the ones received (1-32).
+ *
+ * Blocks may arrive in any order, each is written to flash as it comes in and only the
+ * missing ones are requested again after MY_OTA_RETRY_DELAY. With 1 the node waits for
+ * every block before asking for the next, which takes a round trip to the controller per
+ * 16 bytes. Larger windows mainly help nodes several hops away. Controllers answer each
+ * request with the block it names, so they need no changes.
+ */
+#ifndef MY_OTA_WINDOW_SIZE
+#define MY_OTA_WINDOW_SIZE 4
+#endif
+
+/**
+ * @def MY_OTA_COMPRESSION_FEATURE
+ * @brief Accept compressed firmware images and deltas against the running firmware.
+ *
+ * The node tells the controller which encodings it can decode (FIRMWARE_ENCODING_* in
+ * RequestFirmwareConfig), the controller may then send the image as LZ tokens that refer
+ * back to what was decoded already and, on ATmega nodes, to the firmware the node is
+ * running. The encoded image is kept in the external flash above the first 32K and
+ * decoded into the usual place with a few dozen bytes of RAM, the checksum is taken over
+ * the decoded image. A delta that does not produce the expected image is asked for again
+ * as a whole. examples_Linux/OtaImage encodes images.
+ */
+//#define MY_OTA_COMPRESSION_FEATURE
+
 
 /**********************************
 *  Gateway config
@@ -157,6 +322,12 @@
 #define MY_GATEWAY_MAX_CLIENTS 1
 #endif
 
+// Enables the binary protocol on the serial gateway. The gateway starts in the ASCII protocol
+// and switches when the controller sends I_VERSION with payload "B" (reply payload is "B" followed
+// by the library version). Frames are the raw message header and payload plus a CRC16, COBS encoded
+// and delimited by 0x00. Any ASCII I_VERSION request switches back, so old controllers keep working.
+//#define MY_GATEWAY_BINARY_PROTOCOL
+
 
 
 /**********************************
@@ -266,6 +437,45 @@
 #define MY_VERIFICATION_TIMEOUT_MS 5000
 #endif
 
+/**
+ * @def MY_SIGNING_SESSIONS
+ * @brief Number of nodes whose signed messages can be verified at the same time.
+ *
+ * Each session holds the nonce sent to one node (30 bytes of RAM). Defaults to 4 on
+ * gateways and repeaters and 1 on other nodes.
+ */
+//#define MY_SIGNING_SESSIONS 4
+
+/**
+ * @def MY_SIGNING_NONCE_POOL
+ * @brief Enable to hand out nonces before they are needed.
+ *
+ * After a signed message has been verified, the receiver sends the sender a fresh nonce
+ * (I_NONCE_POOL) which the sender keeps for its next signed message to that node. This saves the
+ * nonce request/response round trip on most signed messages. Enable it on all signing nodes.<br>
+ * A node that sleeps right after sending misses the nonce and falls back to requesting one, as
+ * does every node beyond @ref MY_SIGNING_NONCE_POOL_SIZE.
+ */
+//#define MY_SIGNING_NONCE_POOL
+
+/**
+ * @def MY_SIGNING_NONCE_POOL_TIMEOUT_MS
+ * @brief How long a pre-issued nonce can be used.
+ *
+ * A signed message that is held back by an attacker can still be delivered (once) within this time.
+ */
+#ifndef MY_SIGNING_NONCE_POOL_TIMEOUT_MS
+#define MY_SIGNING_NONCE_POOL_TIMEOUT_MS 600000
+#endif
+
+/**
+ * @def MY_SIGNING_NONCE_POOL_SIZE
+ * @brief Number of nodes nonces are handed out to in advance, and kept from.
+ *
+ * Costs 60 bytes of RAM per node. Defaults to 4 on gateways and repeaters and 1 on other nodes.
+ */
+//#define MY_SIGNING_NONCE_POOL_SIZE 4
+
 /**
  * @def MY_SIGNING_NODE_WHITELISTING
  * @brief Enable to turn on whitelisting
@@ -277,10 +487,23 @@
  * nodes have to implement whitelisting for this to work.<br>
  * Note that a node can still transmit a non-salted message (i.e. have whitelisting disabled)
  * to a node that has whitelisting enabled (assuming the receiver does not have a matching entry
- * for the sender in it's whitelist). The whitelist to use is defined as the value of the flag.
+ * for the sender in it's whitelist). The whitelist to use is defined as the value of the flag.<br>
+ * It is kept in flash. Sorted by nodeId, it is searched by bisection, else scanned.
  */
 //#define MY_SIGNING_NODE_WHITELISTING {{.nodeId = GATEWAY_ADDRESS,.serial = {0x09,0x08,0x07,0x06,0x05,0x04,0x03,0x02,0x01}}}
 
+/**
+ * @def MY_SIGNING_WHITELIST_EEPROM_SIZE
+ * @brief Keep the whitelist in EEPROM, with room for this many nodes (at most 254).
+ *
+ * The list of @ref MY_SIGNING_NODE_WHITELISTING is copied to EEPROM on the first start, after that
+ * the controller adds, replaces and revokes nodes with @ref I_SIGNING_WHITELIST messages.
+ * An entry takes 10 bytes of EEPROM after the sketch area, 1 KB holds 35 of them. With
+ * @ref MY_STATE_LOG_FEATURE the list follows the log, lower @ref MY_STATE_LOG_SIZE to make room
+ * (or raise @ref MY_LINUX_CONFIG_SIZE on Linux). Nodes other than the gateway must require signatures.
+ */
+//#define MY_SIGNING_WHITELIST_EEPROM_SIZE 128
+
 /**
  * @def MY_SIGNING_ATSHA204_PIN
  * @brief Atsha204 default pin setting
@@ -328,6 +551,59 @@
 // Enables RF24 encryption (all nodes and gateway must have this enabled, and all must be personalized with the same AES key)
 //#define MY_RF24_ENABLE_ENCRYPTION
 
+// With MY_RF24_ENABLE_ENCRYPTION, encrypts with AES-CCM instead of CBC. Frames are not padded
+// to 16 or 32 bytes but carry a 3 byte counter, so equal messages no longer give equal frames.
+// The counter takes room from the message, MAX_PAYLOAD drops to 22 bytes (less the tag below).
+// It is kept in EEPROM over reboots and lasts at least 8 million frames (it starts at random),
+// then the node stops sending until the AES key is changed (and the counter cleared). Every
+// frame sent counts, relayed ones too: a node reporting once a minute lasts 16 years, a repeater
+// or gateway sending one frame a second about 100 days. With MY_DEBUG the counter is printed at
+// start, and a warning on every 256 frames of the last million. Nodes without an id send their
+// parent and id requests in clear. All nodes must use the same mode and tag size.
+//#define MY_RF24_ENCRYPTION_CCM
+
+/**
+ * @def MY_RF24_ENCRYPTION_RANDOMSEED_PIN
+ * @brief Pin read for noise when MY_RF24_ENCRYPTION_CCM picks the start of a new frame counter
+ *
+ * Do not connect anything to this when CCM encryption is enabled
+ */
+#ifndef MY_RF24_ENCRYPTION_RANDOMSEED_PIN
+#define MY_RF24_ENCRYPTION_RANDOMSEED_PIN 7
+#endif
+
+/**
+ * @def MY_RF24_ENCRYPTION_MAC_SIZE
+ * @brief Bytes of tag (CBC-MAC) on MY_RF24_ENCRYPTION_CCM frames, 0, 4, 6 or 8.
+ *
+ * Frames without a valid tag, and frames whose counter is not newer than the last one received from
+ * that neighbour, are dropped. Nodes that share the key are then authenticated hop by hop without
+ * the nonce round trip of signing. Replay protection is weaker than signing though: a neighbour
+ * is only tracked while it has one of the @ref MY_RF24_ENCRYPTION_REPLAY_SIZE entries. After the
+ * receiver reboots, or once the entry of a neighbour was replaced, recorded frames of that
+ * neighbour are accepted again (in increasing order) until it sends a newer one.
+ * Counters are only kept in RAM. When a node restarts its counter (EEPROM cleared, or the node is
+ * replaced under the same id), reboot its neighbours, else they may drop its frames as replays.
+ * Each byte is taken from MAX_PAYLOAD, which leaves no room for OTA firmware blocks
+ * (MY_OTA_FIRMWARE_FEATURE does not build with a tag).
+ */
+#ifndef MY_RF24_ENCRYPTION_MAC_SIZE
+#define MY_RF24_ENCRYPTION_MAC_SIZE 0
+#endif
+
+/**
+ * @def MY_RF24_ENCRYPTION_REPLAY_SIZE
+ * @brief Number of neighbours whose last frame counter is kept (with a tag). Each takes 5 bytes of RAM.
+ *
+ * Replay protection only covers this many neighbours. When more nodes are heard, entries are
+ * replaced in turn, by normal traffic or by an attacker replaying frames of other nodes, and frames
+ * of the node dropped from the table can be replayed. 255 keeps a counter for every node id
+ * (1275 bytes of RAM), which closes this on gateways and repeaters that can afford it.
+ */
+#ifndef MY_RF24_ENCRYPTION_REPLAY_SIZE
+#define MY_RF24_ENCRYPTION_REPLAY_SIZE 8
+#endif
+
 /**
  * @def MY_DEBUG_VERBOSE_RF24
  * @brief Enable MY_DEBUG_VERBOSE_RF24 flag for verbose debug prints related to the RF24 driver. Requires DEBUG to be enabled.
@@ -571,6 +847,58 @@
 // If MY_CONTROLLER_IP_ADDRESS is left un-defined, gateway acts as server allowing incoming connections.
 //#define MY_CONTROLLER_IP_ADDRESS 192, 168, 178, 254
 
+/**********************************
+*  ESP8266 Hardware Defaults
+***********************************/
+
+/**
+ * @def MY_ESP8266_CONFIG_COMMIT_DELAY
+ * @brief Milliseconds without config writes before changes are committed to flash.
+ *
+ * Each commit rewrites a whole 4 KB flash sector, so writes (saveState(), routes etc.)
+ * are collected in RAM. Call hwConfigFlush() to commit at once.
+ */
+#ifndef MY_ESP8266_CONFIG_COMMIT_DELAY
+#define MY_ESP8266_CONFIG_COMMIT_DELAY 1000
+#endif
+
+/**
+ * @def MY_ESP8266_CONFIG_COMMIT_MAX_DELAY
+ * @brief Longest time in milliseconds changes stay uncommitted while writes keep coming.
+ */
+#ifndef MY_ESP8266_CONFIG_COMMIT_MAX_DELAY
+#define MY_ESP8266_CONFIG_COMMIT_MAX_DELAY 10000
+#endif
+
+/**********************************
+*  Linux Hardware Defaults
+***********************************/
+
+/**
+ * @def MY_LINUX_CONFIG_FILE
+ * @brief File used to emulate EEPROM when running as a Linux process.
+ */
+#ifndef MY_LINUX_CONFIG_FILE
+#define MY_LINUX_CONFIG_FILE "mysensors.eeprom"
+#endif
+
+/**
+ * @def MY_LINUX_CONFIG_SIZE
+ * @brief Size of the emulated EEPROM (same as ATMega328 by default).
+ */
+#ifndef MY_LINUX_CONFIG_SIZE
+#define MY_LINUX_CONFIG_SIZE 1024
+#endif
+
+/**
+ * @def MY_LINUX_SERIAL_PTY
+ * @brief Serve MY_SERIALDEVICE on a pseudo terminal instead of stdin/stdout.
+ *
+ * The value is the path of a symlink created to the pty slave (or NULL for no link),
+ * e.g. "/dev/ttyMySensorsGateway". The controller can open it like any serial gateway.
+ */
+//#define MY_LINUX_SERIAL_PTY "/dev/ttyMySensorsGateway"
+
 /**
  * @defgroup MyLockgrp MyNodeLock
  * @ingroup internals
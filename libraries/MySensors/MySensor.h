@@ -53,7 +53,7 @@
 #endif
 
 // Enable radio "feature" if one of the radio types was enabled
-#if defined(MY_RADIO_NRF24) || defined(MY_RADIO_RFM69) || defined(MY_RS485)
+#if defined(MY_RADIO_NRF24) || defined(MY_RADIO_RFM69) || defined(MY_RS485) || defined(MY_RADIO_SIM)
 	#define MY_RADIO_FEATURE
 #endif
 
@@ -69,6 +69,10 @@
 	#include "core/MyHwATMega328.cpp"
 #elif defined(ARDUINO_ARCH_SAMD)
         #include "core/MyHwSAMD.cpp"
+#elif defined(__linux__)
+	#include "drivers/Linux/Arduino.cpp"
+	#include "drivers/Linux/LinuxSerial.cpp"
+	#include "core/MyHwLinux.cpp"
 #endif
 
 // LEDS
@@ -142,12 +146,29 @@
 	#include "core/MyLeds.h"
 #endif
 
+// PROFILING
+#if defined(MY_PROFILING)
+	#include "core/MyProfiling.cpp"
+#else
+	#include "core/MyProfiling.h"
+#endif
+
 
 // INCLUSION MODE
 #if defined(MY_INCLUSION_MODE_FEATURE)
 	#include "core/MyInclusionMode.cpp"
 #endif
 
+// SEND QUEUE
+#if defined(MY_SEND_QUEUE_FEATURE)
+	#include "core/MySendQueue.cpp"
+#endif
+
+// WEAR-LEVELED SAVESTATE
+#if defined(MY_STATE_LOG_FEATURE)
+	#include "core/MyStateLog.cpp"
+#endif
+
 
 // SIGNING
 #if defined(MY_SIGNING_ATSHA204) || defined(MY_SIGNING_SOFT)
@@ -172,6 +193,9 @@
 
 
 // GATEWAY - TRANSPORT
+#if defined(MY_GATEWAY_BINARY_PROTOCOL) && !defined(MY_GATEWAY_SERIAL)
+	#error MY_GATEWAY_BINARY_PROTOCOL is only available on the serial gateway
+#endif
 #if defined(MY_GATEWAY_MQTT_CLIENT)
 	#if defined(MY_RADIO_FEATURE)
 		// We assume that a gateway having a radio also should act as repeater
@@ -202,6 +226,9 @@
 
 	// We currently only support one protocol at the moment, enable it.
 	#include "core/MyProtocolMySensors.cpp"
+	#if defined(MY_GATEWAY_BINARY_PROTOCOL)
+		#include "core/MyProtocolBinary.cpp"
+	#endif
 
 	// GATEWAY - CONFIGURATION
 	#if defined(MY_RADIO_FEATURE)
@@ -234,7 +261,7 @@
 
 
 // RADIO
-#if defined(MY_RADIO_NRF24) || defined(MY_RADIO_RFM69) || defined(MY_RS485)
+#if defined(MY_RADIO_FEATURE)
 	// SOFTSPI
 	#ifdef MY_SOFTSPI
 		#if defined(ARDUINO_ARCH_ESP8266)
@@ -251,6 +278,9 @@
 	#if (defined(MY_RADIO_NRF24) && defined(MY_RADIO_RFM69)) || (defined(MY_RADIO_NRF24) && defined(MY_RS485)) || (defined(MY_RADIO_RFM69) && defined(MY_RS485))
 		#error Only one forward link driver can be activated
 	#endif
+	#if defined(MY_RADIO_SIM) && (defined(MY_RADIO_NRF24) || defined(MY_RADIO_RFM69) || defined(MY_RS485))
+		#error Only one forward link driver can be activated
+	#endif
 	#if defined(MY_RADIO_NRF24)
 		#if defined(MY_RF24_ENABLE_ENCRYPTION)
 			#include "drivers/AES/AES.cpp"
@@ -263,6 +293,11 @@
 	#elif defined(MY_RADIO_RFM69)
 		#include "drivers/RFM69/RFM69.cpp"
 		#include "core/MyTransportRFM69.cpp"
+	#elif defined(MY_RADIO_SIM)
+		#if !defined(__linux__)
+			#error The simulated radio is only available on Linux
+		#endif
+		#include "core/MyTransportSim.cpp"
 	#endif
 #endif
 
@@ -272,6 +307,11 @@
 	#undef MY_REPEATER_FEATURE
 	#undef MY_SIGNING_NODE_WHITELISTING
 	#undef MY_SIGNING_FEATURE
+	#undef MY_LINK_STATS_FEATURE
+	#undef MY_ASYNC_TRANSPORT_FEATURE
+#endif
+#if !defined(MY_REPEATER_FEATURE)
+	#undef MY_RAM_ROUTING_TABLE_FEATURE
 #endif
 
 #if !defined(MY_GATEWAY_FEATURE)
@@ -294,6 +334,8 @@
 #if !defined(MY_CORE_ONLY)
 	#if defined(ARDUINO_ARCH_ESP8266)
 		#include "core/MyMainESP8266.cpp"
+	#elif defined(__linux__)
+		#include "core/MyMainLinux.cpp"
 	#else
 		#include "core/MyMainDefault.cpp"
 	#endif
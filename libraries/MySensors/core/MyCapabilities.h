@@ -40,6 +40,8 @@
 	#define MY_CAP_RADIO "R"
 #elif defined(MY_RS485)
 	#define MY_CAP_RADIO "S"
+#elif defined(MY_RADIO_SIM)
+	#define MY_CAP_RADIO "V"
 #else
 	#define MY_CAP_RADIO "-"
 #endif
@@ -58,6 +60,8 @@
 	#define MY_CAP_ARCH "E"
 #elif defined(ARDUINO_ARCH_AVR)
 	#define MY_CAP_ARCH "A"
+#elif defined(__linux__)
+	#define MY_CAP_ARCH "L"
 #else
 	#define MY_CAP_ARCH "-"
 #endif
@@ -19,6 +19,14 @@
 
 #ifndef MyEepromAddresses_h
 #define MyEepromAddresses_h
+// Size of the EEPROM (or the emulation of it) the library may use
+#if defined(__linux__)
+	#define EEPROM_CONFIG_SIZE MY_LINUX_CONFIG_SIZE
+#elif defined(E2END)
+	#define EEPROM_CONFIG_SIZE (E2END+1)
+#else
+	#define EEPROM_CONFIG_SIZE 1024 // ESP8266 and SAMD emulate 1 KB
+#endif
 // EEPROM start address for mysensors library data
 #define EEPROM_START 0
 // EEPROM location of node id
@@ -40,5 +48,13 @@
 #define EEPROM_RF_ENCRYPTION_AES_KEY_ADDRESS (EEPROM_SIGNING_SOFT_SERIAL_ADDRESS+9) // This is set with SecurityPersonalizer.ino
 #define EEPROM_NODE_LOCK_COUNTER (EEPROM_RF_ENCRYPTION_AES_KEY_ADDRESS+16)
 #define EEPROM_LOCAL_CONFIG_ADDRESS (EEPROM_NODE_LOCK_COUNTER+1) // First free address for sketch static configuration
+#define EEPROM_STATE_LOG_ADDRESS (EEPROM_LOCAL_CONFIG_ADDRESS+256) // Wear-leveled saveState() log (MY_STATE_LOG_FEATURE)
+#define EEPROM_RF24_COUNTER_ADDRESS (EEPROM_CONFIG_SIZE-2) // Frame counter block of MY_RF24_ENCRYPTION_CCM (last 2 bytes)
+// Whitelist edited by the controller (MY_SIGNING_WHITELIST_EEPROM_SIZE), where the state log ends when it is used
+#if defined(MY_STATE_LOG_FEATURE)
+	#define EEPROM_SIGNING_WHITELIST_ADDRESS (EEPROM_STATE_LOG_ADDRESS+MY_STATE_LOG_SIZE)
+#else
+	#define EEPROM_SIGNING_WHITELIST_ADDRESS EEPROM_STATE_LOG_ADDRESS
+#endif
 
 #endif
@@ -39,6 +39,13 @@ inline void gatewayTransportProcess() {
 			}
 			if (mGetCommand(_msg) == C_INTERNAL) {
 				if (_msg.type == I_VERSION) {
+				#if defined(MY_GATEWAY_BINARY_PROTOCOL)
+					if (_msg.data[0] == 'B' && _msg.data[1] == 0) {
+						// Controller asks for the binary protocol. Confirm in the current protocol, then switch
+						gatewayTransportSend(buildGw(_msg, I_VERSION).set("B" LIBRARY_VERSION));
+						gatewayTransportSetBinary(true);
+					} else
+				#endif
 					// Request for version. Create the response
 					gatewayTransportSend(buildGw(_msg, I_VERSION).set(LIBRARY_VERSION));
 				#ifdef MY_INCLUSION_MODE_FEATURE
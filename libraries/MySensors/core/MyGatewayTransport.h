@@ -49,4 +49,11 @@ bool gatewayTransportAvailable();
  */
 MyMessage& gatewayTransportReceive();
 
+#if defined(MY_GATEWAY_BINARY_PROTOCOL)
+/*
+ * Switch between ASCII and binary protocol for the following messages
+ */
+void gatewayTransportSetBinary(bool binary);
+#endif
+
 #endif /* MyGatewayTransportEthernet_h */
@@ -59,7 +59,14 @@ MyMessage _mqttMsg;
 bool gatewayTransportSend(MyMessage &message) {
 	if (!_client.connected())
 		return false;
-	snprintf_P(_fmtBuffer, MY_GATEWAY_MAX_SEND_LENGTH, PSTR(MY_MQTT_PUBLISH_TOPIC_PREFIX "/%d/%d/%d/%d/%d"), message.sender, message.sensor, mGetCommand(message), mGetAck(message), message.type);
+	// Topic prefix is truncated if needed to leave room for the header fields
+	static const char prefix[] PROGMEM = MY_MQTT_PUBLISH_TOPIC_PREFIX "/";
+	size_t prefixLength = sizeof(prefix) - 1;
+	if (prefixLength > MY_GATEWAY_MAX_SEND_LENGTH - PROTOCOL_HEADER_MAX_LENGTH - 1) {
+		prefixLength = MY_GATEWAY_MAX_SEND_LENGTH - PROTOCOL_HEADER_MAX_LENGTH - 1;
+	}
+	memcpy_P(_fmtBuffer, prefix, prefixLength);
+	*protocolFormatHeader(_fmtBuffer + prefixLength, message, '/') = 0;
 	debug(PSTR("Sending message on topic: %s\n"), _fmtBuffer);
 	return _client.publish(_fmtBuffer, message.getString(_convBuffer));
 }
@@ -29,8 +29,54 @@ char _serialInputString[MY_GATEWAY_MAX_RECEIVE_LENGTH];    // A buffer for incom
 int _serialInputPos;
 MyMessage _serialMsg;
 
+#if defined(MY_GATEWAY_BINARY_PROTOCOL)
+// Controller negotiated the binary protocol (see MY_GATEWAY_BINARY_PROTOCOL)
+bool _serialBinary;
+
+void gatewayTransportSetBinary(bool binary) {
+	_serialBinary = binary;
+	_serialInputPos = 0;
+}
+
+// Handles one byte in binary mode, returns true when a complete message is in _serialMsg
+static bool gatewayTransportBinaryByte(uint8_t inByte) {
+	if (inByte == 0) {
+		// Frame delimiter
+		bool ok = _serialInputPos && protocolParseBinary(_serialMsg, (uint8_t *)_serialInputString, _serialInputPos);
+		_serialInputPos = 0;
+		return ok;
+	}
+	if (inByte == '\n' && _serialInputPos && _serialInputString[0] >= '0' && _serialInputString[0] <= '9') {
+		// A COBS frame never starts with a digit (block lengths are below '0'), so this is an
+		// ASCII line. A controller that (re)connects asks for the version, answer it in ASCII.
+		_serialInputString[_serialInputPos] = 0;
+		bool ok = protocolParse(_serialMsg, _serialInputString) &&
+			mGetCommand(_serialMsg) == C_INTERNAL && _serialMsg.type == I_VERSION;
+		_serialInputPos = 0;
+		if (ok) {
+			_serialBinary = false;
+		}
+		return ok;
+	}
+	if (_serialInputPos < MY_GATEWAY_MAX_RECEIVE_LENGTH - 1) {
+		_serialInputString[_serialInputPos++] = inByte;
+	} else {
+		// Frame too long. Throw away
+		_serialInputPos = 0;
+	}
+	return false;
+}
+#endif
+
 
 bool gatewayTransportSend(MyMessage &message) {
+	#if defined(MY_GATEWAY_BINARY_PROTOCOL)
+		if (_serialBinary) {
+			uint8_t frame[PROTOCOL_BINARY_MAX_FRAME_LENGTH];
+			MY_SERIALDEVICE.write(frame, protocolFormatBinary(message, frame));
+			return true;
+		}
+	#endif
 	MY_SERIALDEVICE.print(protocolFormat(message));
 	// Serial print is always successful
 	return true;
@@ -46,6 +92,14 @@ bool gatewayTransportAvailable() {
 	while (MY_SERIALDEVICE.available()) {
 		// get the new byte:
 		char inChar = (char) MY_SERIALDEVICE.read();
+		#if defined(MY_GATEWAY_BINARY_PROTOCOL)
+			if (_serialBinary) {
+				if (gatewayTransportBinaryByte(inChar)) {
+					return true;
+				}
+				continue;
+			}
+		#endif
 		// if the incoming character is a newline, set a flag
 		// so the main loop can do something about it:
 		if (_serialInputPos < MY_GATEWAY_MAX_RECEIVE_LENGTH - 1) {
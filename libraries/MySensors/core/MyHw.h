@@ -35,11 +35,15 @@
 #define hwWatchdogReset() wdt_reset()
 #define hwReboot() wdt_enable(WDTO_15MS); while (1)
 #define hwMillis() millis()
+#define hwMicros() micros()
 
 void hwReadConfigBlock(void* buf, void* adr, size_t length);
 void hwWriteConfigBlock(void* buf, void* adr, size_t length);
 void hwWriteConfig(int adr, uint8_t value);
 uint8_t hwReadConfig(int adr);
+void hwConfigFlush(); // Make pending config writes durable
+void hwConfigProcess(); // Called from _process(), for platforms that defer config writes
+void hwReadFirmwareBlock(void* buf, uint16_t adr, size_t length); // Optional, reads the running sketch for OTA deltas
 */
 
 int8_t hwSleep(unsigned long ms);
@@ -61,6 +61,7 @@ do { 																\
 #define hwWatchdogReset() wdt_reset()
 #define hwReboot() wdt_enable(WDTO_15MS); while (1)
 #define hwMillis() millis()
+#define hwMicros() micros()
 #define hwReadConfig(__pos) (eeprom_read_byte((uint8_t*)(__pos)))
 
 #ifndef eeprom_update_byte
@@ -72,6 +73,11 @@ do { 																\
 //
 #define hwReadConfigBlock(__buf, __pos, __length) (eeprom_read_block((__buf), (void*)(__pos), (__length)))
 #define hwWriteConfigBlock(__pos, __buf, __length) (eeprom_write_block((void*)(__pos), (void*)__buf, (__length)))
+// EEPROM writes are immediate
+#define hwConfigFlush()
+#define hwConfigProcess()
+// The running sketch starts at flash address 0, OTA deltas copy from it
+#define hwReadFirmwareBlock(__buf, __pos, __length) (memcpy_P((__buf), (const void*)(__pos), (__length)))
 
 
 
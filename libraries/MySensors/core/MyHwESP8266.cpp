@@ -18,6 +18,7 @@
  */
 
 #include "MyHwESP8266.h"
+#include "MyEepromAddresses.h"
 #include <EEPROM.h>
 
 /*
@@ -40,7 +41,12 @@ ISR (WDT_vect)
 }
 */
 
-static void hwInitConfigBlock( size_t length = 1024 /*ATMega328 has 1024 bytes*/ )
+// Writes only go to the RAM copy of EEPROM, hwConfigProcess() commits them
+static bool _configDirty;
+static unsigned long _configFirstWrite;
+static unsigned long _configLastWrite;
+
+static void hwInitConfigBlock( size_t length = EEPROM_CONFIG_SIZE )
 {
   static bool initDone = false;
   if (!initDone)
@@ -66,11 +72,48 @@ void hwWriteConfigBlock(void* buf, void* adr, size_t length)
   hwInitConfigBlock();
   uint8_t* src = static_cast<uint8_t*>(buf);
   int offs = reinterpret_cast<int>(adr);
+  bool changed = false;
   while (length-- > 0)
   {
-    EEPROM.write(offs++, *src++);
+    if (EEPROM.read(offs) != *src)
+    {
+      EEPROM.write(offs, *src);
+      changed = true;
+    }
+    offs++;
+    src++;
+  }
+  if (changed)
+  {
+    _configLastWrite = hwMillis();
+    if (!_configDirty)
+    {
+      _configDirty = true;
+      _configFirstWrite = _configLastWrite;
+    }
+  }
+}
+
+void hwConfigFlush()
+{
+  if (_configDirty)
+  {
+    EEPROM.commit();
+    _configDirty = false;
+  }
+}
+
+void hwConfigProcess()
+{
+  if (_configDirty)
+  {
+    unsigned long now = hwMillis();
+    if (now - _configLastWrite >= MY_ESP8266_CONFIG_COMMIT_DELAY ||
+        now - _configFirstWrite >= MY_ESP8266_CONFIG_COMMIT_MAX_DELAY)
+    {
+      hwConfigFlush();
+    }
   }
-  EEPROM.commit();
 }
 
 uint8_t hwReadConfig(int adr)
@@ -91,12 +134,14 @@ void hwWriteConfig(int adr, uint8_t value)
 
 
 int8_t hwSleep(unsigned long ms) {
+	hwConfigFlush();
 	// TODO: Not supported!
 	(void)ms;
 	return -2;
 }
 
 int8_t hwSleep(uint8_t interrupt, uint8_t mode, unsigned long ms) {
+	hwConfigFlush();
 	// TODO: Not supported!
 	(void)interrupt;
 	(void)mode;
@@ -105,6 +150,7 @@ int8_t hwSleep(uint8_t interrupt, uint8_t mode, unsigned long ms) {
 }
 
 int8_t hwSleep(uint8_t interrupt1, uint8_t mode1, uint8_t interrupt2, uint8_t mode2, unsigned long ms) {
+	hwConfigFlush();
 	// TODO: Not supported!
 	(void)interrupt1;
 	(void)mode1;
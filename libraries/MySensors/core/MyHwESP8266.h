@@ -36,13 +36,18 @@
 #define hwDigitalWrite(__pin, __value) (digitalWrite(__pin, __value))
 #define hwInit() MY_SERIALDEVICE.begin(MY_BAUD_RATE); MY_SERIALDEVICE.setDebugOutput(true)
 #define hwWatchdogReset() wdt_reset()
-#define hwReboot() wdt_enable(WDTO_15MS); while (1)
+#define hwReboot() hwConfigFlush(); wdt_enable(WDTO_15MS); while (1)
 #define hwMillis() millis()
+#define hwMicros() micros()
 
 void hwReadConfigBlock(void* buf, void* adr, size_t length);
 void hwWriteConfigBlock(void* buf, void* adr, size_t length);
 void hwWriteConfig(int adr, uint8_t value);
 uint8_t hwReadConfig(int adr);
+// Commit pending config writes to flash
+void hwConfigFlush();
+// Commit pending config writes once they have settled (called from _process())
+void hwConfigProcess();
 
 
 #endif // #ifdef ARDUINO_ARCH_ESP8266
@@ -0,0 +1,176 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#include "MyHwLinux.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(MY_RADIO_SIM)
+	#include "drivers/RadioSim/RadioSim.h"
+#endif
+
+static uint8_t _configBlock[MY_LINUX_CONFIG_SIZE];
+static int _configFd = -1;
+
+static void hwInitConfigBlock()
+{
+	static bool initDone = false;
+	if (initDone) {
+		return;
+	}
+	initDone = true;
+	// Unwritten EEPROM reads as 0xFF
+	memset(_configBlock, 0xFF, sizeof(_configBlock));
+	#if defined(MY_RADIO_SIM)
+		// Simulated nodes keep their EEPROM in memory, seeded by the simulator
+		_simHost->loadConfig(_configBlock, sizeof(_configBlock));
+		return;
+	#endif
+	_configFd = open(MY_LINUX_CONFIG_FILE, O_RDWR | O_CREAT, 0600);
+	if (_configFd < 0) {
+		fprintf(stderr, "Could not open " MY_LINUX_CONFIG_FILE ": %s, config will not persist\n", strerror(errno));
+		return;
+	}
+	ssize_t len = pread(_configFd, _configBlock, sizeof(_configBlock), 0);
+	if (len < (ssize_t)sizeof(_configBlock)) {
+		// New (or short) image, fill up the rest with erased cells
+		if (len < 0) {
+			len = 0;
+		}
+		if (pwrite(_configFd, _configBlock + len, sizeof(_configBlock) - len, len) < 0) {
+			fprintf(stderr, "Could not write " MY_LINUX_CONFIG_FILE ": %s\n", strerror(errno));
+		}
+	}
+}
+
+void hwReadConfigBlock(void* buf, void* adr, size_t length)
+{
+	hwInitConfigBlock();
+	size_t offs = reinterpret_cast<size_t>(adr);
+	if (offs >= sizeof(_configBlock)) {
+		return;
+	}
+	length = min(length, sizeof(_configBlock) - offs);
+	memcpy(buf, _configBlock + offs, length);
+}
+
+void hwWriteConfigBlock(void* buf, void* adr, size_t length)
+{
+	hwInitConfigBlock();
+	size_t offs = reinterpret_cast<size_t>(adr);
+	if (offs >= sizeof(_configBlock)) {
+		return;
+	}
+	length = min(length, sizeof(_configBlock) - offs);
+	memcpy(_configBlock + offs, buf, length);
+	if (_configFd >= 0 && pwrite(_configFd, _configBlock + offs, length, offs) < 0) {
+		fprintf(stderr, "Could not write " MY_LINUX_CONFIG_FILE ": %s\n", strerror(errno));
+	}
+}
+
+uint8_t hwReadConfig(int adr)
+{
+	uint8_t value = 0xFF;
+	hwReadConfigBlock(&value, reinterpret_cast<void*>(adr), 1);
+	return value;
+}
+
+void hwWriteConfig(int adr, uint8_t value)
+{
+	uint8_t curr = hwReadConfig(adr);
+	if (curr != value)
+	{
+		hwWriteConfigBlock(&value, reinterpret_cast<void*>(adr), 1);
+	}
+}
+
+void hwConfigFlush()
+{
+	if (_configFd >= 0) {
+		fdatasync(_configFd);
+	}
+}
+
+void hwInit() {
+	#if defined(MY_LINUX_SERIAL_PTY)
+		MY_SERIALDEVICE.setPty(MY_LINUX_SERIAL_PTY);
+	#endif
+	MY_SERIALDEVICE.begin(MY_BAUD_RATE);
+}
+
+void hwReboot() {
+	#if defined(MY_RADIO_SIM)
+		// Other nodes share this process. The sketch stops but the node keeps routing for
+		// the others, e.g. after an OTA update in a rollout simulation.
+		debug(PSTR("reboot not supported in simulation, routing only\n"));
+		while (1) {
+			wait(1000);
+		}
+	#endif
+	// Restart the process image, config survives in the EEPROM file
+	fflush(NULL);
+	execl("/proc/self/exe", "/proc/self/exe", (char *)NULL);
+	exit(EXIT_FAILURE);
+}
+
+int8_t hwSleep(unsigned long ms) {
+	delay(ms);
+	return -1;
+}
+
+int8_t hwSleep(uint8_t interrupt, uint8_t mode, unsigned long ms) {
+	// Not supported, there are no interrupt pins
+	(void)interrupt;
+	(void)mode;
+	(void)ms;
+	return -2;
+}
+
+int8_t hwSleep(uint8_t interrupt1, uint8_t mode1, uint8_t interrupt2, uint8_t mode2, unsigned long ms) {
+	// Not supported, there are no interrupt pins
+	(void)interrupt1;
+	(void)mode1;
+	(void)interrupt2;
+	(void)mode2;
+	(void)ms;
+	return -2;
+}
+
+#ifdef MY_DEBUG
+void hwDebugPrint(const char *fmt, ... ) {
+	char fmtBuffer[300];
+	#ifdef MY_GATEWAY_FEATURE
+		// prepend debug message to be handled correctly by controller (C_INTERNAL, I_LOG_MESSAGE)
+		snprintf(fmtBuffer, 299, "0;255;%d;0;%d;", C_INTERNAL, I_LOG_MESSAGE);
+		MY_SERIALDEVICE.print(fmtBuffer);
+	#endif
+	va_list args;
+	va_start (args, fmt );
+	#ifdef MY_GATEWAY_FEATURE
+		// Truncate message if this is gateway node
+		vsnprintf(fmtBuffer, MY_GATEWAY_MAX_SEND_LENGTH, fmt, args);
+		fmtBuffer[MY_GATEWAY_MAX_SEND_LENGTH-1] = '\n';
+		fmtBuffer[MY_GATEWAY_MAX_SEND_LENGTH] = '\0';
+	#else
+		vsnprintf(fmtBuffer, 299, fmt, args);
+	#endif
+	va_end (args);
+	MY_SERIALDEVICE.print(fmtBuffer);
+}
+#endif
@@ -0,0 +1,61 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ *******************************
+ *
+ * Hardware layer for running a sketch as a native Linux process. There is no SPI or radio
+ * driver for Linux yet, so a native gateway has no real radio: the sketch must define no
+ * MY_RADIO_* (a serial gateway talking to the controller only), or MY_RADIO_SIM to run in
+ * drivers/RadioSim/examples_Linux/NetworkSim. Build it with the MySensors directory and
+ * drivers/Linux on the include path, e.g. for a sketch with only MY_GATEWAY_SERIAL defined:
+ *
+ *   g++ -O2 -x c++ Gateway.ino -I libraries/MySensors -I libraries/MySensors/drivers/Linux -o gateway
+ *
+ * Sketches with MY_RADIO_SIM are built as shared objects, see NetworkSim.cpp.
+ * EEPROM is emulated by the file @ref MY_LINUX_CONFIG_FILE and MY_SERIALDEVICE is
+ * stdin/stdout (or a pty, see @ref MY_LINUX_SERIAL_PTY).
+ */
+#ifndef MyHwLinux_h
+#define MyHwLinux_h
+
+#include "MyHw.h"
+
+#ifdef __cplusplus
+#include <Arduino.h>
+#endif
+
+#define MY_SERIALDEVICE Serial
+
+
+#define hwDigitalWrite(__pin, __value) (digitalWrite(__pin, __value))
+#define hwWatchdogReset()
+#define hwMillis() millis()
+#define hwMicros() micros()
+
+void hwInit();
+void hwReboot();
+
+void hwReadConfigBlock(void* buf, void* adr, size_t length);
+void hwWriteConfigBlock(void* buf, void* adr, size_t length);
+void hwWriteConfig(int adr, uint8_t value);
+uint8_t hwReadConfig(int adr);
+// Writes go to the config file at once, this syncs it to disk
+void hwConfigFlush();
+#define hwConfigProcess()
+
+#endif // #ifdef MyHwLinux_h
@@ -20,6 +20,7 @@
 #define MyHwSAMD_h
 
 #include "MyHw.h"
+#include "MyEepromAddresses.h"
 #include <Wire.h>
 
 #ifdef __cplusplus
@@ -37,17 +38,20 @@
 
 // Define these as macros to save valuable space
 
-uint8_t configBlock[1024];
+uint8_t configBlock[EEPROM_CONFIG_SIZE];
 #define hwDigitalWrite(__pin, __value) (digitalWrite(__pin, __value))
 void hwInit();
 void hwWatchdogReset();
 void hwReboot();
 #define hwMillis() millis()
+#define hwMicros() micros()
 
 void hwReadConfigBlock(void* buf, void* adr, size_t length);
 void hwWriteConfigBlock(void* buf, void* adr, size_t length);
 void hwWriteConfig(int adr, uint8_t value);
 uint8_t hwReadConfig(int adr);
+#define hwConfigFlush()
+#define hwConfigProcess()
 
 #define MY_SERIALDEVICE SerialUSB
 
@@ -0,0 +1,15 @@
+// Initialize library and handle sketch functions like we want to
+
+#if defined(MY_RADIO_SIM)
+// Each simulated node runs this on its own stack inside the simulator process
+RADIOSIM_EXPORT void simNodeMain(void) {
+#else
+int main(void) {
+#endif
+	_begin(); // Startup MySensors library
+
+	for(;;) {
+		_process();  // Process incoming data
+		if (loop) loop(); // Call sketch loop
+	}
+}
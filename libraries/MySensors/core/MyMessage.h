@@ -37,7 +37,12 @@
 #endif
 
 #define PROTOCOL_VERSION 2    //!< The version of the protocol
-#define MAX_MESSAGE_LENGTH 32 //!< The maximum size of a message (including header)
+#if defined(MY_RF24_ENABLE_ENCRYPTION) && defined(MY_RF24_ENCRYPTION_CCM)
+	// The frame counter and tag go into the 32 byte radio frame as well
+	#define MAX_MESSAGE_LENGTH (32 - 3 - MY_RF24_ENCRYPTION_MAC_SIZE) //!< The maximum size of a message (including header)
+#else
+	#define MAX_MESSAGE_LENGTH 32 //!< The maximum size of a message (including header)
+#endif
 #define HEADER_SIZE 7         //!< The size of the header
 #define MAX_PAYLOAD (MAX_MESSAGE_LENGTH - HEADER_SIZE) //!< The maximum size of a payload depends on #MAX_MESSAGE_LENGTH and #HEADER_SIZE
 
@@ -171,7 +176,13 @@ typedef enum {
 	I_NONCE_REQUEST,        //!< Request for a nonce
 	I_NONCE_RESPONSE,       //!< Payload is nonce data
 	I_HEARTBEAT, I_PRESENTATION, I_DISCOVER, I_DISCOVER_RESPONSE, I_HEARTBEAT_RESPONSE,
-	I_LOCKED                //!< Node is locked (reason in string-payload)
+	I_LOCKED,               //!< Node is locked (reason in string-payload)
+	I_LINK_STATS,           //!< Request link statistics of a node (MY_LINK_STATS_FEATURE)
+	I_LINK_STATS_RESPONSE,  //!< Statistics of one neighbor (custom payload, see LinkStats)
+	I_PROFILE,              //!< Request receive path timing histograms (MY_PROFILING), payload "C" clears them
+	I_PROFILE_RESPONSE,     //!< Half a histogram (custom payload, see ProfileReport)
+	I_NONCE_POOL,           //!< Nonce for the next signed message, sent unrequested (MY_SIGNING_NONCE_POOL)
+	I_SIGNING_WHITELIST     //!< Whitelist entry "nodeId:serial" (hex) to add, "nodeId" to remove (MY_SIGNING_WHITELIST_EEPROM_SIZE)
 } mysensor_internal;
 
 
@@ -0,0 +1,66 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#include "MyProfiling.h"
+
+unsigned long _profileStart[PROFILE_STAGES];
+uint16_t _profileHistogram[PROFILE_STAGES][PROFILE_BUCKETS];
+
+void profileRecord(uint8_t stage, unsigned long us) {
+	uint8_t bucket = 0;
+	for (us >>= 2; us && bucket < PROFILE_BUCKETS - 1; us >>= 1) {
+		bucket++;
+	}
+	if (_profileHistogram[stage][bucket] != 0xFFFF) {
+		_profileHistogram[stage][bucket]++;
+	}
+}
+
+void profileClear() {
+	memset(_profileHistogram, 0, sizeof(_profileHistogram));
+}
+
+void profilePrint() {
+	#if defined(MY_DEBUG)
+		for (uint8_t stage = 0; stage < PROFILE_STAGES; stage++) {
+			const uint16_t *h = _profileHistogram[stage];
+			debug(PSTR("prof %d: %u %u %u %u %u %u %u %u %u %u %u %u %u %u %u %u\n"), stage,
+				h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7], h[8], h[9], h[10], h[11], h[12], h[13], h[14], h[15]);
+		}
+	#endif
+}
+
+void profileSend() {
+	ProfileReport report;
+	for (uint8_t stage = 0; stage < PROFILE_STAGES; stage++) {
+		for (uint8_t first = 0; first < PROFILE_BUCKETS; first += PROFILE_BUCKETS / 2) {
+			// Copy first, sending is profiled as well
+			memcpy(report.count, &_profileHistogram[stage][first], sizeof(report.count));
+			bool empty = true;
+			for (uint8_t i = 0; i < PROFILE_BUCKETS / 2; i++) {
+				empty &= !report.count[i];
+			}
+			if (!empty) {
+				report.stage = stage;
+				report.firstBucket = first;
+				_sendRoute(build(_msg, _nc.nodeId, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_PROFILE_RESPONSE, false).set(&report, sizeof(ProfileReport)));
+			}
+		}
+	}
+}
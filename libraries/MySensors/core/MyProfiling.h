@@ -0,0 +1,61 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#ifndef MyProfiling_h
+#define MyProfiling_h
+
+/// @brief Stages of receiving a message that are timed with MY_PROFILING
+typedef enum {
+	PROFILE_RADIO_READ,     //!< Polling the radio and reading the frame (or taking it from the receive buffer)
+	PROFILE_MESSAGE,        //!< All processing of the message (transportProcessMessage)
+	PROFILE_VERIFY,         //!< signerVerifyMsg
+	PROFILE_DEBUG,          //!< Formatting and printing the debug line of the message
+	PROFILE_GATEWAY_SEND,   //!< Handing the message to the controller (gatewayTransportSend)
+	PROFILE_RECEIVE,        //!< The sketch's receive() callback
+	PROFILE_STAGES
+} profile_stage;
+
+// Log2 histogram: bucket 0 holds durations below 4us, bucket n from 2^(n+1)us, the last one everything from 65ms
+#define PROFILE_BUCKETS 16
+
+#ifdef MY_PROFILING
+	#define profileBegin(stage) _profileStart[stage] = hwMicros()
+	#define profileEnd(stage) profileRecord(stage, hwMicros() - _profileStart[stage])
+
+	/// @brief Payload of I_PROFILE_RESPONSE, half of the histogram of one stage (little endian)
+	typedef struct {
+		uint8_t stage; //!< See profile_stage
+		uint8_t firstBucket; //!< Bucket of count[0]
+		uint16_t count[PROFILE_BUCKETS / 2]; //!< Durations per bucket (stops at 65535)
+	} __attribute__((packed)) ProfileReport;
+
+	extern unsigned long _profileStart[PROFILE_STAGES];
+
+	void profileRecord(uint8_t stage, unsigned long us);
+	void profileClear();
+	void profilePrint(); // Print all histograms as debug lines (needs MY_DEBUG)
+	void profileSend(); // Send all histograms to the controller as I_PROFILE_RESPONSE
+
+#else
+	// Remove profiling if disabled
+	#define profileBegin(stage)
+	#define profileEnd(stage)
+#endif
+
+#endif
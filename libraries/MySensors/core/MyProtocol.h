@@ -31,4 +31,55 @@ bool protocolParse(MyMessage &message, char *inputString);
 // Format MyMessage to the protocol represenataion
 char *protocolFormat(MyMessage &message);
 
+#if defined(MY_GATEWAY_BINARY_PROTOCOL)
+// Decoded binary frame: message header, payload and CRC16
+#define PROTOCOL_BINARY_MAX_DECODED_LENGTH (HEADER_SIZE + MAX_PAYLOAD + 2)
+// Encoded binary frame: COBS adds one byte (frames are shorter than 254 bytes), plus a 0x00 on each side
+#define PROTOCOL_BINARY_MAX_FRAME_LENGTH (PROTOCOL_BINARY_MAX_DECODED_LENGTH + 3)
+
+// Decode a COBS frame (without delimiters), check the CRC and unpack it into message.
+// The frame is decoded in place. Returns true if the frame holds a valid message.
+bool protocolParseBinary(MyMessage &message, uint8_t *frame, uint8_t length);
+
+// Encode message into frame (at least PROTOCOL_BINARY_MAX_FRAME_LENGTH bytes), returns frame length
+uint8_t protocolFormatBinary(MyMessage &message, uint8_t *frame);
+#endif
+
+// Longest output of protocolFormatHeader() ("255;255;255;255;255")
+#define PROTOCOL_HEADER_MAX_LENGTH 19
+
+// "00".."99", used to convert header fields two digits at a time
+static const char _protocolDigitPairs[] PROGMEM =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+// Write value in decimal, returns end of written text (not null terminated)
+static inline char *protocolFormatUint8(char *dst, uint8_t value) {
+	if (value >= 100) {
+		uint8_t hundreds = value >= 200 ? 2 : 1;
+		*dst++ = '0' + hundreds;
+		value -= hundreds * 100;
+	} else if (value < 10) {
+		*dst++ = '0' + value;
+		return dst;
+	}
+	*dst++ = pgm_read_byte(&_protocolDigitPairs[value * 2]);
+	*dst++ = pgm_read_byte(&_protocolDigitPairs[value * 2 + 1]);
+	return dst;
+}
+
+// Write "sender<sep>sensor<sep>command<sep>ack<sep>type", returns end of written text (not null terminated)
+static inline char *protocolFormatHeader(char *dst, MyMessage &message, char separator) {
+	dst = protocolFormatUint8(dst, message.sender);
+	*dst++ = separator;
+	dst = protocolFormatUint8(dst, message.sensor);
+	*dst++ = separator;
+	dst = protocolFormatUint8(dst, mGetCommand(message));
+	*dst++ = separator;
+	dst = protocolFormatUint8(dst, mGetAck(message));
+	*dst++ = separator;
+	return protocolFormatUint8(dst, message.type);
+}
+
 #endif
@@ -0,0 +1,100 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#include "MyConfig.h"
+#include "MyProtocol.h"
+
+// CRC-16/CCITT-FALSE (polynomial 0x1021, init 0xFFFF), a byte at a time without a table
+static inline uint16_t protocolCrc16Update(uint16_t crc, uint8_t data) {
+	uint8_t x = (crc >> 8) ^ data;
+	x ^= x >> 4;
+	return (crc << 8) ^ ((uint16_t)x << 12) ^ ((uint16_t)x << 5) ^ x;
+}
+
+// Append one byte to the COBS output. code points at the length byte of the open block,
+// run is its value so far (written when the block is closed).
+static inline void protocolCobsPut(uint8_t *&dst, uint8_t *&code, uint8_t &run, uint8_t value) {
+	if (value) {
+		*dst++ = value;
+		run++;
+	} else {
+		*code = run;
+		code = dst++;
+		run = 1;
+	}
+}
+
+bool protocolParseBinary(MyMessage &message, uint8_t *frame, uint8_t length) {
+	if (length < HEADER_SIZE + 3 || length > PROTOCOL_BINARY_MAX_DECODED_LENGTH + 1)
+		return false;
+	// COBS decode in place (the output never overtakes the input) and run the CRC over
+	// everything, including the CRC bytes themselves. That leaves 0 for an intact frame.
+	const uint8_t *in = frame;
+	const uint8_t *end = frame + length;
+	uint8_t *out = frame;
+	uint16_t crc = ~0;
+	while (in < end) {
+		uint8_t code = *in++;
+		if (code == 0 || code - 1 > end - in)
+			return false;
+		for (const uint8_t *blockEnd = in + code - 1; in < blockEnd; ) {
+			crc = protocolCrc16Update(crc, *in);
+			*out++ = *in++;
+		}
+		if (code < 0xFF && in < end) {
+			crc = protocolCrc16Update(crc, 0);
+			*out++ = 0;
+		}
+	}
+	uint8_t messageLength = out - frame - 2;
+	if (crc || messageLength < HEADER_SIZE)
+		return false;
+
+	memcpy((void *)&message, frame, messageLength);
+	uint8_t payloadLength = messageLength - HEADER_SIZE;
+	if (mGetLength(message) != payloadLength || mGetCommand(message) > C_STREAM)
+		return false;
+	// Same as the ASCII protocol: the message comes from the gateway and is never signed yet
+	message.sender = GATEWAY_ADDRESS;
+	message.last = GATEWAY_ADDRESS;
+	mSetAck(message, false);
+	mSetSigned(message, false);
+	message.data[payloadLength] = 0;
+	return true;
+}
+
+uint8_t protocolFormatBinary(MyMessage &message, uint8_t *frame) {
+	const uint8_t *src = (const uint8_t *)&message;
+	uint8_t length = HEADER_SIZE + min(mGetLength(message), MAX_PAYLOAD);
+	uint16_t crc = ~0;
+	uint8_t *dst = frame;
+	// Leading delimiter lets the controller resync after debug prints or line noise
+	*dst++ = 0;
+	uint8_t *code = dst++;
+	uint8_t run = 1;
+	for (uint8_t i = 0; i < length; i++) {
+		crc = protocolCrc16Update(crc, src[i]);
+		protocolCobsPut(dst, code, run, src[i]);
+	}
+	protocolCobsPut(dst, code, run, crc >> 8);
+	protocolCobsPut(dst, code, run, crc & 0xFF);
+	*code = run;
+	*dst++ = 0;
+	return dst - frame;
+}
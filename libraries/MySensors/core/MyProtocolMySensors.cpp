@@ -21,94 +21,97 @@
 #include "MyTransport.h"
 #include "MyProtocol.h"
 
-uint8_t protocolH2i(char c);
-
 char _fmtBuffer[MY_GATEWAY_MAX_SEND_LENGTH];
 char _convBuffer[MAX_PAYLOAD*2+1];
 
+// Hex digit value, 0xFF if c is not a hex digit
+static inline uint8_t protocolHexNibble(char c) {
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	c |= 0x20; // lower case
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	return 0xFF;
+}
+
+static inline bool protocolIsEndOfLine(char c) {
+	return c == 0 || c == '\r' || c == '\n';
+}
+
+// Parses "destination;sensor;command;ack;type;payload" in a single pass, straight into message.
+// All numeric fields must be present and in range, the payload is optional.
 bool protocolParse(MyMessage &message, char *inputString) {
-	char *str, *p, *value=NULL;
-	uint8_t bvalue[MAX_PAYLOAD];
-	uint8_t blen = 0;
-	int i = 0;
-	uint8_t command = 0;
-	uint8_t ack = 0;
+	const char *p = inputString;
+	uint8_t field[5];
 
-	// Extract command data coming on serial line
-	for (str = strtok_r(inputString, ";", &p); // split using semicolon
-		str && i < 6; // loop while str is not null an max 5 times
-		str = strtok_r(NULL, ";", &p) // get subsequent tokens
-			) {
-		switch (i) {
-			case 0: // Radioid (destination)
-				message.destination = atoi(str);
-				break;
-			case 1: // Childid
-				message.sensor = atoi(str);
-				break;
-			case 2: // Message type
-				command = atoi(str);
-				mSetCommand(message, command);
-				break;
-			case 3: // Should we request ack from destination?
-				ack = atoi(str);
-				break;
-			case 4: // Data type
-				message.type = atoi(str);
-				break;
-			case 5: // Variable value
-				if (command == C_STREAM) {
-					blen = 0;
-					uint8_t val;
-					while (*str) {
-						val = protocolH2i(*str++) << 4;
-						val += protocolH2i(*str++);
-						bvalue[blen] = val;
-						blen++;
-					}
-				} else {
-					value = str;
-					// Remove trailing carriage return and newline character (if it exists)
-					uint8_t lastCharacter = strlen(value)-1;
-					if (value[lastCharacter] == '\r')
-						value[lastCharacter] = 0;
-					if (value[lastCharacter] == '\n')
-						value[lastCharacter] = 0;
-				}
-				break;
+	for (uint8_t i = 0; i < 5; i++) {
+		if (*p < '0' || *p > '9')
+			return false;
+		uint16_t value = 0;
+		do {
+			value = value * 10 + (*p++ - '0');
+			if (value > 255)
+				return false;
+		} while (*p >= '0' && *p <= '9');
+		field[i] = value;
+		if (*p == ';') {
+			p++;
+		} else if (i < 4 || !protocolIsEndOfLine(*p)) {
+			return false;
 		}
-		i++;
 	}
-	//debug(PSTR("Received %d"), i);
-	// Check for invalid input
-	if (i < 5)
+	uint8_t command = field[2];
+	uint8_t ack = field[3];
+	if (command > C_STREAM || ack > 1)
 		return false;
 
+	message.destination = field[0];
+	message.sensor = field[1];
+	mSetCommand(message, command);
+	message.type = field[4];
 	message.sender = GATEWAY_ADDRESS;
 	message.last = GATEWAY_ADDRESS;
-    mSetRequestAck(message, ack?1:0);
-    mSetAck(message, false);
-	if (command == C_STREAM)
-		message.set(bvalue, blen);
-	else
-		message.set(value);
+	mSetRequestAck(message, ack);
+	mSetAck(message, false);
+
+	uint8_t length = 0;
+	if (command == C_STREAM) {
+		// Hex decode into the payload
+		while (!protocolIsEndOfLine(*p)) {
+			uint8_t high = protocolHexNibble(*p++);
+			uint8_t low = protocolHexNibble(*p++);
+			if (high == 0xFF || low == 0xFF || length == MAX_PAYLOAD)
+				return false;
+			message.data[length++] = (high << 4) | low;
+		}
+		mSetPayloadType(message, P_CUSTOM);
+	} else {
+		// Copy up to end of line, truncating to payload size as MyMessage::set() does
+		while (!protocolIsEndOfLine(*p) && length < MAX_PAYLOAD) {
+			message.data[length++] = *p++;
+		}
+		message.data[length] = 0;
+		mSetPayloadType(message, P_STRING);
+	}
+	mSetLength(message, length);
 	return true;
 }
 
 char * protocolFormat(MyMessage &message) {
-	snprintf_P(_fmtBuffer, MY_GATEWAY_MAX_SEND_LENGTH, PSTR("%d;%d;%d;%d;%d;%s\n"), message.sender, message.sensor, (uint8_t)mGetCommand(message), (uint8_t)mGetAck(message), message.type, message.getString(_convBuffer));
+	char *p = protocolFormatHeader(_fmtBuffer, message, ';');
+	*p++ = ';';
+	#if MY_GATEWAY_MAX_SEND_LENGTH >= PROTOCOL_HEADER_MAX_LENGTH + MAX_PAYLOAD*2 + 3
+		// Longest payload (hex of a full custom payload) always fits, convert in place
+		*p = 0;
+		message.getString(p);
+		p += strlen(p);
+	#else
+		char *end = _fmtBuffer + MY_GATEWAY_MAX_SEND_LENGTH - 2;
+		for (const char *s = message.getString(_convBuffer); *s && p < end; ) {
+			*p++ = *s++;
+		}
+	#endif
+	*p++ = '\n';
+	*p = 0;
 	return _fmtBuffer;
 }
-
-uint8_t protocolH2i(char c) {
-	uint8_t i = 0;
-	if (c <= '9')
-		i += c - '0';
-	else if (c >= 'a')
-		i += c - 'a' + 10;
-	else
-		i += c - 'A' + 10;
-	return i;
-}
-
-
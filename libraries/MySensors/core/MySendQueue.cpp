@@ -0,0 +1,81 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#include "MySendQueue.h"
+
+// Slots stay untouched after completion so the status can be read until they are reused
+SendQueueEntry _sendQueue[MY_SEND_QUEUE_SIZE];
+uint8_t _sendQueueHead; // Oldest pending entry
+uint8_t _sendQueueCount; // Number of pending entries
+uint8_t _sendQueueHandle; // Last handle handed out
+bool _sendQueueBusy; // Guards against draining from within a send (nonce exchange, parent search)
+
+int8_t sendAsync(MyMessage &message, bool enableAck, sendCallback callback) {
+	if (_sendQueueCount == MY_SEND_QUEUE_SIZE) {
+		debug(PSTR("send queue full\n"));
+		return -1;
+	}
+	SendQueueEntry &entry = _sendQueue[(_sendQueueHead + _sendQueueCount) % MY_SEND_QUEUE_SIZE];
+	entry.msg = message;
+	entry.msg.sender = _nc.nodeId;
+	mSetCommand(entry.msg, C_SET);
+	mSetRequestAck(entry.msg, enableAck);
+	entry.callback = callback;
+	_sendQueueHandle = (_sendQueueHandle + 1) & 0x7F;
+	entry.handle = _sendQueueHandle;
+	entry.status = SEND_PENDING;
+	_sendQueueCount++;
+	return entry.handle;
+}
+
+mysensor_send_status sendStatus(int8_t handle) {
+	for (uint8_t i = 0; i < MY_SEND_QUEUE_SIZE; i++) {
+		if (_sendQueue[i].handle == handle && _sendQueue[i].status != SEND_UNKNOWN) {
+			return (mysensor_send_status)_sendQueue[i].status;
+		}
+	}
+	return SEND_UNKNOWN;
+}
+
+uint8_t sendQueuePending() {
+	return _sendQueueCount;
+}
+
+void sendQueueFlush() {
+	while (_sendQueueCount && !_sendQueueBusy) {
+		_process();
+	}
+}
+
+void sendQueueProcess() {
+	if (_sendQueueBusy || !_sendQueueCount) {
+		return;
+	}
+	_sendQueueBusy = true;
+	// Entry stays counted while it is sent, so nothing queued meanwhile can take its slot
+	SendQueueEntry &entry = _sendQueue[_sendQueueHead];
+	bool ok = _sendRoute(entry.msg);
+	entry.status = ok ? SEND_OK : SEND_FAILED;
+	if (entry.callback) {
+		entry.callback(entry.handle, entry.msg, ok);
+	}
+	_sendQueueHead = (_sendQueueHead + 1) % MY_SEND_QUEUE_SIZE;
+	_sendQueueCount--;
+	_sendQueueBusy = false;
+}
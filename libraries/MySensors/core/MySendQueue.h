@@ -0,0 +1,36 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#ifndef MySendQueue_h
+#define MySendQueue_h
+
+#include "MySensorCore.h"
+
+/// @brief Outbound queue entry
+typedef struct {
+	MyMessage msg; //!< Copy of the message to send
+	sendCallback callback; //!< Called when the message has been sent (or NULL)
+	int8_t handle; //!< Handle returned by sendAsync()
+	uint8_t status; //!< See mysensor_send_status
+} SendQueueEntry;
+
+// Transmit the oldest queued message (called from _process())
+void sendQueueProcess();
+
+#endif
@@ -34,7 +34,12 @@ void (*_timeCallback)(unsigned long); // Callback for requested time messages
 
 void _process() {
 	hwWatchdogReset();
+	hwConfigProcess();
 
+	#if defined(MY_LINK_STATS_FEATURE) && defined(MY_LINK_STATS_REPORT_INTERVAL)
+		// Before receiving, the report is built in _msg
+		transportLinkStatsProcess();
+	#endif
 
 	#if defined (MY_LEDS_BLINKING_FEATURE)
 		ledsProcess();
@@ -51,7 +56,18 @@ void _process() {
 	#if defined(MY_RADIO_FEATURE)
 		transportProcess();
 	#endif
-	
+
+	#if defined(MY_ASYNC_TRANSPORT_FEATURE)
+		transportStateProcess();
+	#endif
+
+	#if defined(MY_SEND_QUEUE_FEATURE)
+		sendQueueProcess();
+	#endif
+
+	#if defined(MY_RAM_ROUTING_TABLE_FEATURE)
+		transportRoutesProcess();
+	#endif
 }
 
 #if defined(MY_RADIO_FEATURE)
@@ -62,7 +78,7 @@ static inline bool isValidParent( const uint8_t parent ) {
 
 void _infiniteLoop() {
 	while(1) {
-		#if defined(MY_GATEWAY_ESP8266)
+		#if defined(MY_GATEWAY_ESP8266) || defined(__linux__)
 			yield();
 		#endif
 	}
@@ -92,6 +108,18 @@ void _begin() {
 		} else {
 			debug(PSTR("Radio init successful.\n"));
 		}
+		#if defined(MY_RAM_ROUTING_TABLE_FEATURE)
+			transportLoadRoutes();
+		#endif
+		#if defined(MY_LINK_STATS_FEATURE)
+			for (uint8_t i = 0; i < MY_LINK_STATS_SIZE; i++) {
+				_linkStats[i].nodeId = AUTO;
+			}
+		#endif
+		#if defined(MY_MESSAGE_SEQUENCE_FEATURE)
+			// Continuing at 0 after a reboot would repeat the numbers of the last messages sent
+			_sequence = random(256) ^ hwMicros();
+		#endif
 	#endif
 
 	#if defined(MY_GATEWAY_FEATURE)
@@ -143,6 +171,7 @@ void _begin() {
 			_nc.distance = 1;
 		} else if (!isValidParent(_nc.parentNodeId)) {
 			// Auto find parent, but parent in eeprom is invalid. Try find one.
+			// (only starts the search with MY_ASYNC_TRANSPORT_FEATURE)
 			transportFindParentNode();
 		}
 
@@ -187,11 +216,16 @@ void _begin() {
 		setup();
 
 
-	#if defined(MY_RADIO_FEATURE)
-		transportPresentNode();
+	#if defined(MY_ASYNC_TRANSPORT_FEATURE)
+		// Continues in the background, presents the node once parent and id are known
+		transportConnect();
+	#else
+		#if defined(MY_RADIO_FEATURE)
+			transportPresentNode();
+		#endif
+		if (presentation)
+			presentation();
 	#endif
-	if (presentation)
-		presentation();
 
 	debug(PSTR("Init complete, id=%d, parent=%d, distance=%d\n"), _nc.nodeId, _nc.parentNodeId, _nc.distance);
 }
@@ -207,6 +241,15 @@ uint8_t getParentNodeId() {
 	return _nc.parentNodeId;
 }
 
+bool isTransportReady() {
+	#if defined(MY_RADIO_FEATURE)
+		// Also while searching for a better parent, the current one is used meanwhile
+		return _nc.parentNodeId != AUTO && _nc.nodeId != AUTO;
+	#else
+		return true;
+	#endif
+}
+
 ControllerConfig getConfig() {
 	return _cc;
 }
@@ -233,27 +276,45 @@ boolean _sendRoute(MyMessage &message) {
 	#endif
 }
 
+// Sends what send() queued earlier, so that messages sent directly do not overtake it
+static void _sendQueued() {
+	#if defined(MY_SEND_QUEUE_FEATURE)
+		// Not from within a queued send (a callback), its own entry is still pending
+		while (_sendQueueCount && !_sendQueueBusy) {
+			sendQueueProcess();
+		}
+	#endif
+}
+
 bool send(MyMessage &message, bool enableAck) {
-	message.sender = _nc.nodeId;
-	mSetCommand(message,C_SET);
-    mSetRequestAck(message,enableAck);
-	return _sendRoute(message);
+	#if defined(MY_SEND_QUEUE_FEATURE)
+		return sendAsync(message, enableAck) >= 0;
+	#else
+		message.sender = _nc.nodeId;
+		mSetCommand(message,C_SET);
+		mSetRequestAck(message,enableAck);
+		return _sendRoute(message);
+	#endif
 }
 
 void sendBatteryLevel(uint8_t value, bool enableAck) {
+	_sendQueued();
 	_sendRoute(build(_msg, _nc.nodeId, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_BATTERY_LEVEL, enableAck).set(value));
 }
 
 void sendHeartbeat(void) {
+	_sendQueued();
 	_sendRoute(build(_msg, _nc.nodeId, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_HEARTBEAT_RESPONSE, false).set(_heartbeat));
 
 }
 
 void present(uint8_t childSensorId, uint8_t sensorType, const char *description, bool enableAck) {
+	_sendQueued();
 	_sendRoute(build(_msg, _nc.nodeId, GATEWAY_ADDRESS, childSensorId, C_PRESENTATION, sensorType, enableAck).set(childSensorId==NODE_SENSOR_ID?LIBRARY_VERSION:description));
 }
 
 void sendSketchInfo(const char *name, const char *version, bool enableAck) {
+	_sendQueued();
 	if (name != NULL) {
 		_sendRoute(build(_msg, _nc.nodeId, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_SKETCH_NAME, enableAck).set(name));
 	}
@@ -263,10 +324,12 @@ void sendSketchInfo(const char *name, const char *version, bool enableAck) {
 }
 
 void request(uint8_t childSensorId, uint8_t variableType, uint8_t destination) {
+	_sendQueued();
 	_sendRoute(build(_msg, _nc.nodeId, destination, childSensorId, C_REQ, variableType, false).set(""));
 }
 
 void requestTime() {
+	_sendQueued();
 	_sendRoute(build(_msg, _nc.nodeId, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_TIME, false).set(""));
 }
 
@@ -277,6 +340,9 @@ void _processInternalMessages() {
 
 	#if !defined(MY_DISABLE_REMOTE_RESET)
 		if (type == I_REBOOT) {
+			#if defined(MY_REPEATER_FEATURE)
+				transportSaveRoutes();
+			#endif
 			// Requires MySensors or other bootloader with watchdogs enabled
 			hwReboot();
 		} else
@@ -307,15 +373,31 @@ void _processInternalMessages() {
 		if (receiveTime)
 			receiveTime(_msg.getULong());
 	}
+	#if defined(MY_LINK_STATS_FEATURE)
+		else if (type == I_LINK_STATS) {
+			transportSendLinkStats();
+		}
+	#endif
+	#if defined(MY_SIGNING_WHITELIST_EEPROM_SIZE)
+		else if (type == I_SIGNING_WHITELIST) {
+			signerWhitelistUpdate(_msg.getString());
+		}
+	#endif
+	#if defined(MY_PROFILING)
+		else if (type == I_PROFILE) {
+			if (_msg.getString()[0] == 'C') {
+				profileClear();
+			} else {
+				profileSend();
+			}
+		}
+	#endif
 	#if defined(MY_REPEATER_FEATURE)
 		if (type == I_CHILDREN) {
 			if (_msg.getString()[0] == 'C') {
 				// Clears child relay data for this node
 				debug(PSTR("clear routing table\n"));
-				uint8_t i = 255;
-				do {
-					hwWriteConfig(EEPROM_ROUTES_ADDRESS+i, BROADCAST_ADDRESS);
-				} while (i--);
+				transportClearRoutes();
 				// Clear parent node id & distance to gw
 				hwWriteConfig(EEPROM_PARENT_NODE_ID_ADDRESS, AUTO);
 				hwWriteConfig(EEPROM_DISTANCE_ADDRESS, DISTANCE_INVALID);
@@ -328,12 +410,14 @@ void _processInternalMessages() {
 }
 
 
+#if !defined(MY_STATE_LOG_FEATURE)
 void saveState(uint8_t pos, uint8_t value) {
 	hwWriteConfig(EEPROM_LOCAL_CONFIG_ADDRESS+pos, value);
 }
 uint8_t loadState(uint8_t pos) {
 	return hwReadConfig(EEPROM_LOCAL_CONFIG_ADDRESS+pos);
 }
+#endif
 
 
 void wait(unsigned long ms) {
@@ -372,6 +456,9 @@ int8_t sleep(unsigned long ms) {
 		wait(ms);
 		return -1;
 	#else
+		#if defined(MY_SEND_QUEUE_FEATURE)
+			sendQueueFlush();
+		#endif
 		#if defined(MY_RADIO_FEATURE)
 			transportPowerDown();
 		#endif
@@ -402,6 +489,9 @@ int8_t sleep(uint8_t interrupt, uint8_t mode, unsigned long ms) {
 		(void)ms;
 		return -2;
 	#else
+		#if defined(MY_SEND_QUEUE_FEATURE)
+			sendQueueFlush();
+		#endif
 		#if defined(MY_RADIO_FEATURE)
 			transportPowerDown();
 		#endif
@@ -434,6 +524,9 @@ int8_t sleep(uint8_t interrupt1, uint8_t mode1, uint8_t interrupt2, uint8_t mode
 		(void)ms;
 		return -2;
 	#else
+		#if defined(MY_SEND_QUEUE_FEATURE)
+			sendQueueFlush();
+		#endif
 		#if defined(MY_RADIO_FEATURE)
 			transportPowerDown();
 		#endif
@@ -76,6 +76,12 @@ uint8_t getNodeId();
  */
 uint8_t getParentNodeId();
 
+/**
+ * Return true if the node has a parent and a node id, i.e. messages can be sent to the controller.
+ * With MY_ASYNC_TRANSPORT_FEATURE this becomes true some time after setup().
+ */
+bool isTransportReady();
+
 /**
 * Each node must present all attached sensors before any values can be handled correctly by the controller.
 * It is usually good to present all attached sensors after power-up in setup().
@@ -103,9 +109,53 @@ void sendSketchInfo(const char *name, const char *version, bool ack=false);
 * @param msg Message to send
 * @param ack Set this to true if you want destination node to send ack back to this node. Default is not to request any ack.
 * @return true Returns true if message reached the first stop on its way to destination.
+* With MY_SEND_QUEUE_FEATURE it returns as soon as the message is queued, true if there was room for it.
 */
 bool send(MyMessage &msg, bool ack=false);
 
+#if defined(MY_SEND_QUEUE_FEATURE)
+/// @brief Status of a message passed to sendAsync()
+typedef enum {
+	SEND_UNKNOWN, //!< Handle never issued or its queue slot has been reused
+	SEND_PENDING, //!< Waiting in queue
+	SEND_OK, //!< Reached the first stop on its way to destination
+	SEND_FAILED //!< Could not be delivered to the first stop
+} mysensor_send_status;
+
+/**
+ * Completion callback for sendAsync(). Called from _process() (i.e. from wait() or between
+ * loop() calls). The message is only valid during the callback.
+ */
+typedef void (*sendCallback)(int8_t handle, const MyMessage &msg, bool ok);
+
+/**
+* Queues a message for sending and returns immediately. Queued messages are sent one per
+* _process() pass, so incoming messages keep being handled while the queue drains.
+*
+* @param msg Message to send (copied)
+* @param ack Set this to true if you want destination node to send ack back to this node.
+* @param callback Called when the message has been sent, NULL if not needed
+* @return Handle for sendStatus(), -1 if the queue is full (see MY_SEND_QUEUE_SIZE)
+*/
+int8_t sendAsync(MyMessage &msg, bool ack=false, sendCallback callback=NULL);
+
+/**
+ * Returns the status of a queued message.
+ * @param handle Handle returned by sendAsync()
+ */
+mysensor_send_status sendStatus(int8_t handle);
+
+/**
+ * Returns the number of messages waiting in the queue.
+ */
+uint8_t sendQueuePending();
+
+/**
+ * Sends all queued messages before returning. Called before the radio is powered down in sleep().
+ */
+void sendQueueFlush();
+#endif
+
 
 /**
  * Send this nodes battery level to gateway.
@@ -150,6 +200,8 @@ ControllerConfig getConfig();
  *
  * You have 256 bytes to play with. Note that there is a limitation on the number
  * of writes the EEPROM can handle (~100 000 cycles on ATMega328).
+ * On ESP8266 the value reaches flash a little later, call hwConfigFlush() if it
+ * must survive an immediate power loss.
  *
  * @param pos The position to store value in (0-255)
  * @param value to store in position
@@ -38,12 +38,20 @@ uint8_t _doSign[32];      // Bitfield indicating which sensors require signed co
 uint8_t _doWhitelist[32]; // Bitfield indicating which sensors require serial salted signatures
 MyMessage _msgSign;       // Buffer for message to sign.
 uint8_t _signingNonceStatus;
+signing_session_t _signingSessions[MY_SIGNING_SESSIONS]; // Nonces handed out, one per sender
+#if defined(MY_SIGNING_NONCE_POOL)
+signing_session_t _signingIssued[MY_SIGNING_NONCE_POOL_SIZE];    // Nonces handed out in advance
+signing_session_t _signingNoncePool[MY_SIGNING_NONCE_POOL_SIZE]; // Nonces handed to us in advance
+#endif
 
 #ifdef MY_NODE_LOCK_FEATURE
 static uint8_t nof_nonce_requests = 0;
 static uint8_t nof_failed_verifications = 0;
 #endif
 
+// Sender of an unused verification session (no node has id 255)
+#define SIGNING_SESSION_FREE 0xFF
+
 // Status when waiting for signing nonce in signerProcessInternal
 enum { SIGN_WAITING_FOR_NONCE = 0, SIGN_OK = 1 };
 
@@ -63,7 +71,6 @@ enum { SIGN_WAITING_FOR_NONCE = 0, SIGN_OK = 1 };
  */
 #if defined(MY_SIGNING_SOFT)
 extern void signerAtsha204SoftInit(void);
-extern bool signerAtsha204SoftCheckTimer(void);
 extern bool signerAtsha204SoftGetNonce(MyMessage &msg);
 extern void signerAtsha204SoftPutNonce(MyMessage &msg);
 extern bool signerAtsha204SoftVerifyMsg(MyMessage &msg);
@@ -71,7 +78,6 @@ extern bool signerAtsha204SoftSignMsg(MyMessage &msg);
 #endif
 #if defined(MY_SIGNING_ATSHA204)
 extern void signerAtsha204Init(void);
-extern bool signerAtsha204CheckTimer(void);
 extern bool signerAtsha204GetNonce(MyMessage &msg);
 extern void signerAtsha204PutNonce(MyMessage &msg);
 extern bool signerAtsha204VerifyMsg(MyMessage &msg);
@@ -85,6 +91,7 @@ static bool skipSign(MyMessage &msg) {
 		return true;
 	}	else if (mGetCommand(msg) == C_INTERNAL &&
 		(msg.type == I_NONCE_REQUEST || msg.type == I_NONCE_RESPONSE       || msg.type == I_SIGNING_PRESENTATION ||
+	   msg.type == I_NONCE_POOL    ||
 	   msg.type == I_ID_REQUEST    || msg.type == I_ID_RESPONSE          ||
 	   msg.type == I_FIND_PARENT   || msg.type == I_FIND_PARENT_RESPONSE ||
 	   msg.type == I_HEARTBEAT     || msg.type == I_HEARTBEAT_RESPONSE)) {
@@ -99,8 +106,331 @@ static bool skipSign(MyMessage &msg) {
 		return false;
 	}
 }
+
+// Entry of sender in table, NULL if there is none
+static signing_session_t* signerSessionFind(signing_session_t* table, uint8_t size, uint8_t sender) {
+	for (uint8_t i = 0; i < size; i++) {
+		if (table[i].sender == sender) {
+			return &table[i];
+		}
+	}
+	return NULL;
+}
+
+// Store a nonce for sender: reuse its entry, else a free one, else drop the oldest
+static void signerSessionStore(signing_session_t* table, uint8_t size, uint8_t sender,
+	const uint8_t* nonce) {
+	signing_session_t* session = signerSessionFind(table, size, sender);
+	if (!session) {
+		session = signerSessionFind(table, size, SIGNING_SESSION_FREE);
+	}
+	if (!session) {
+		session = table;
+		for (uint8_t i = 1; i < size; i++) {
+			if (hwMillis() - table[i].timestamp > hwMillis() - session->timestamp) {
+				session = &table[i];
+			}
+		}
+	}
+	session->sender = sender;
+	session->timestamp = hwMillis();
+	memcpy(session->nonce, nonce, MAX_PAYLOAD);
+}
+
+// A nonce is only used once
+static void signerSessionClose(signing_session_t* s) {
+	memset(s->nonce, 0xAA, MAX_PAYLOAD);
+	s->sender = SIGNING_SESSION_FREE;
+}
+
+// Purge nonces that have not been used in time, returns false if any expired
+static bool signerSessionsPurge(signing_session_t* table, uint8_t size, unsigned long timeout) {
+	bool ok = true;
+	for (uint8_t i = 0; i < size; i++) {
+		signing_session_t* s = &table[i];
+		if (s->sender != SIGNING_SESSION_FREE && hwMillis() - s->timestamp > timeout) {
+			SIGN_DEBUG(PSTR("Verification timeout for %d\n"), s->sender);
+			signerSessionClose(s);
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+bool signerSessionTake(uint8_t sender, uint8_t* nonce) {
+	unsigned long timeout = MY_VERIFICATION_TIMEOUT_MS;
+	signing_session_t* s = signerSessionFind(_signingSessions, MY_SIGNING_SESSIONS, sender);
+#if defined(MY_SIGNING_NONCE_POOL)
+	if (!s) {
+		timeout = MY_SIGNING_NONCE_POOL_TIMEOUT_MS;
+		s = signerSessionFind(_signingIssued, MY_SIGNING_NONCE_POOL_SIZE, sender);
+	}
+#endif
+	if (!s) {
+		return false;
+	}
+	bool valid = hwMillis() - s->timestamp <= timeout;
+	if (valid) {
+		memcpy(nonce, s->nonce, MAX_PAYLOAD);
+	}
+	signerSessionClose(s);
+	return valid;
+}
+
+// Generate a nonce for destination and send it as type (I_NONCE_RESPONSE or I_NONCE_POOL)
+static void signerSendNonce(uint8_t destination, uint8_t type) {
+#if defined(MY_SIGNING_SOFT)
+	if (signerAtsha204SoftGetNonce(_msgTmp)) {
+#endif
+#if defined(MY_SIGNING_ATSHA204)
+	if (signerAtsha204GetNonce(_msgTmp)) {
+#endif
+		// Remember the nonce until the signed message arrives
+#if defined(MY_SIGNING_NONCE_POOL)
+		if (type == I_NONCE_POOL) {
+			signerSessionStore(_signingIssued, MY_SIGNING_NONCE_POOL_SIZE, destination,
+				(uint8_t*)_msgTmp.getCustom());
+		} else
+#endif
+		{
+			signerSessionStore(_signingSessions, MY_SIGNING_SESSIONS, destination,
+				(uint8_t*)_msgTmp.getCustom());
+		}
+		SIGN_DEBUG(PSTR("Transmittng nonce\n"));
+		_sendRoute(build(_msgTmp, _nc.nodeId, destination, NODE_SENSOR_ID, C_INTERNAL, type, false));
+	} else {
+		SIGN_DEBUG(PSTR("Failed to generate nonce!\n"));
+	}
+}
+
+#if defined(MY_SIGNING_REQUEST_SIGNATURES)
+static bool signerBackendVerifyMsg(MyMessage &msg) {
+#if defined(MY_SIGNING_SOFT)
+	return signerAtsha204SoftVerifyMsg(msg);
+#endif
+#if defined(MY_SIGNING_ATSHA204)
+	return signerAtsha204VerifyMsg(msg);
+#endif
+}
+#endif
+
+#if defined(MY_SIGNING_NONCE_POOL)
+// Sign msg with a nonce its destination has handed out in advance, false if there is none
+static bool signerSignPooled(MyMessage &msg) {
+	signing_session_t* s = signerSessionFind(_signingNoncePool, MY_SIGNING_NONCE_POOL_SIZE, msg.destination);
+	if (!s) {
+		return false;
+	}
+	// Leave the message time to reach the destination before the nonce expires there
+	bool valid = hwMillis() - s->timestamp < MY_SIGNING_NONCE_POOL_TIMEOUT_MS - MY_VERIFICATION_TIMEOUT_MS;
+	MyMessage nonce;
+	nonce.set(s->nonce, MAX_PAYLOAD);
+	signerSessionClose(s);
+	if (!valid) {
+		return false;
+	}
+#if defined(MY_SIGNING_SOFT)
+	signerAtsha204SoftPutNonce(nonce);
+	valid = signerAtsha204SoftSignMsg(msg);
+#endif
+#if defined(MY_SIGNING_ATSHA204)
+	signerAtsha204PutNonce(nonce);
+	valid = signerAtsha204SignMsg(msg);
+#endif
+	if (valid) {
+		SIGN_DEBUG(PSTR("Message signed with nonce from pool\n"));
+	}
+	return valid;
+}
+#endif
+
+#if defined(MY_SIGNING_NODE_WHITELISTING)
+// The list from the sketch. Kept in flash, looked up by binary search if it is sorted by nodeId
+const whitelist_entry_t _signing_whitelist[] PROGMEM = MY_SIGNING_NODE_WHITELISTING;
+
+#if defined(MY_SIGNING_WHITELIST_EEPROM_SIZE)
+// The whitelist in use is a count followed by entries sorted by nodeId in EEPROM. An erased
+// count means it was never written, it is then seeded from the list in flash.
+#if MY_SIGNING_WHITELIST_EEPROM_SIZE > 254
+	#error MY_SIGNING_WHITELIST_EEPROM_SIZE must be 254 or less
+#endif
+#if !defined(MY_GATEWAY_FEATURE) && !defined(MY_SIGNING_REQUEST_SIGNATURES)
+	// Only a verified message may change which nodes are trusted
+	#error MY_SIGNING_WHITELIST_EEPROM_SIZE requires MY_SIGNING_REQUEST_SIGNATURES on nodes
+#endif
+#define WHITELIST_ENTRY_SIZE (1 + SHA204_SERIAL_SZ) // sizeof(whitelist_entry_t), usable by the preprocessor
+#define WHITELIST_END (EEPROM_SIGNING_WHITELIST_ADDRESS + 1 + MY_SIGNING_WHITELIST_EEPROM_SIZE * WHITELIST_ENTRY_SIZE)
+#if WHITELIST_END > EEPROM_CONFIG_SIZE
+	#error MY_SIGNING_WHITELIST_EEPROM_SIZE does not fit in EEPROM (lower it, or MY_STATE_LOG_SIZE)
+#endif
+#if defined(MY_RF24_ENCRYPTION_CCM) && WHITELIST_END > EEPROM_RF24_COUNTER_ADDRESS
+	#error MY_SIGNING_WHITELIST_EEPROM_SIZE overlaps the MY_RF24_ENCRYPTION_CCM frame counter (last 2 bytes of EEPROM)
+#endif
+#define WHITELIST_UNSEEDED 0xFF
+#define WHITELIST_ENTRY_ADDRESS(i) (EEPROM_SIGNING_WHITELIST_ADDRESS + 1 + (size_t)(i) * WHITELIST_ENTRY_SIZE)
+
+static uint8_t _signingWhitelistCount;
+
+static uint8_t signerWhitelistNodeId(uint8_t i) {
+	return hwReadConfig(WHITELIST_ENTRY_ADDRESS(i));
+}
+
+static void signerWhitelistRead(uint8_t i, whitelist_entry_t* entry) {
+	hwReadConfigBlock((void*)entry, (void*)WHITELIST_ENTRY_ADDRESS(i), sizeof(whitelist_entry_t));
+}
+
+static void signerWhitelistWrite(uint8_t i, whitelist_entry_t* entry) {
+	hwWriteConfigBlock((void*)entry, (void*)WHITELIST_ENTRY_ADDRESS(i), sizeof(whitelist_entry_t));
+}
+#else
+static uint8_t _signingWhitelistCount = NUM_OF(_signing_whitelist);
+static bool _signingWhitelistSorted;
+
+static uint8_t signerWhitelistNodeId(uint8_t i) {
+	return pgm_read_byte(&_signing_whitelist[i].nodeId);
+}
+
+static void signerWhitelistRead(uint8_t i, whitelist_entry_t* entry) {
+	memcpy_P(entry, &_signing_whitelist[i], sizeof(whitelist_entry_t));
+}
+#endif
+
+// Index of the entry of nodeId, or of where it would be inserted
+static uint8_t signerWhitelistFind(uint8_t nodeId) {
+#if !defined(MY_SIGNING_WHITELIST_EEPROM_SIZE)
+	if (!_signingWhitelistSorted) {
+		for (uint8_t i = 0; i < _signingWhitelistCount; i++) {
+			if (signerWhitelistNodeId(i) == nodeId) {
+				return i;
+			}
+		}
+		return _signingWhitelistCount;
+	}
+#endif
+	uint8_t low = 0;
+	uint8_t high = _signingWhitelistCount;
+	while (low < high) {
+		uint8_t mid = (low + high) / 2;
+		if (signerWhitelistNodeId(mid) < nodeId) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+#if defined(MY_SIGNING_WHITELIST_EEPROM_SIZE)
+// Hex digit value, 0xFF if c is not a hex digit
+static uint8_t signerHexNibble(char c) {
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	c |= 0x20; // lower case
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	return 0xFF;
+}
+
+// Add or replace the entry of a node, or remove it if serial is NULL. False if the list is full.
+static bool signerWhitelistStore(uint8_t nodeId, const uint8_t* serial) {
+	whitelist_entry_t entry;
+	uint8_t i = signerWhitelistFind(nodeId);
+	bool found = i < _signingWhitelistCount && signerWhitelistNodeId(i) == nodeId;
+	if (serial) {
+		if (!found) {
+			if (_signingWhitelistCount == MY_SIGNING_WHITELIST_EEPROM_SIZE) {
+				return false;
+			}
+			// Make room, starting from the end
+			for (uint8_t j = _signingWhitelistCount; j > i; j--) {
+				signerWhitelistRead(j - 1, &entry);
+				signerWhitelistWrite(j, &entry);
+			}
+			_signingWhitelistCount++;
+		}
+		entry.nodeId = nodeId;
+		memcpy(entry.serial, serial, SHA204_SERIAL_SZ);
+		signerWhitelistWrite(i, &entry);
+	} else if (found) {
+		_signingWhitelistCount--;
+		for (uint8_t j = i; j < _signingWhitelistCount; j++) {
+			signerWhitelistRead(j + 1, &entry);
+			signerWhitelistWrite(j, &entry);
+		}
+	}
+	hwWriteConfig(EEPROM_SIGNING_WHITELIST_ADDRESS, _signingWhitelistCount);
+	return true;
+}
+#endif
+
+static void signerWhitelistInit(void) {
+#if defined(MY_SIGNING_WHITELIST_EEPROM_SIZE)
+	_signingWhitelistCount = hwReadConfig(EEPROM_SIGNING_WHITELIST_ADDRESS);
+	if (_signingWhitelistCount == WHITELIST_UNSEEDED) {
+		SIGN_DEBUG(PSTR("Copying whitelist to EEPROM\n"));
+		_signingWhitelistCount = 0;
+		for (uint8_t i = 0; i < NUM_OF(_signing_whitelist); i++) {
+			whitelist_entry_t entry;
+			memcpy_P(&entry, &_signing_whitelist[i], sizeof(whitelist_entry_t));
+			(void)signerWhitelistStore(entry.nodeId, entry.serial);
+		}
+	} else if (_signingWhitelistCount > MY_SIGNING_WHITELIST_EEPROM_SIZE) {
+		// Written by a build with a larger list
+		_signingWhitelistCount = MY_SIGNING_WHITELIST_EEPROM_SIZE;
+	}
+#else
+	_signingWhitelistSorted = true;
+	for (uint8_t i = 1; i < _signingWhitelistCount; i++) {
+		if (signerWhitelistNodeId(i - 1) >= signerWhitelistNodeId(i)) {
+			SIGN_DEBUG(PSTR("Whitelist is not sorted by nodeId, it will be scanned\n"));
+			_signingWhitelistSorted = false;
+			break;
+		}
+	}
+#endif
+}
+
+bool signerWhitelistLookup(uint8_t nodeId, uint8_t* serial) {
+	uint8_t i = signerWhitelistFind(nodeId);
+	if (i == _signingWhitelistCount || signerWhitelistNodeId(i) != nodeId) {
+		return false;
+	}
+	whitelist_entry_t entry;
+	signerWhitelistRead(i, &entry);
+	memcpy(serial, entry.serial, SHA204_SERIAL_SZ);
+	return true;
+}
+#endif // MY_SIGNING_NODE_WHITELISTING
 #endif // MY_SIGNING_FEATURE
 
+void signerWhitelistUpdate(const char* entry) {
+#if defined(MY_SIGNING_FEATURE) && defined(MY_SIGNING_NODE_WHITELISTING) && defined(MY_SIGNING_WHITELIST_EEPROM_SIZE)
+	// "nodeId" removes the node, "nodeId:serial" (serial in hex) adds or replaces it
+	uint8_t nodeId = atoi(entry);
+	const char* p = strchr(entry, ':');
+	uint8_t serial[SHA204_SERIAL_SZ];
+	if (p) {
+		p++;
+		for (uint8_t i = 0; i < SHA204_SERIAL_SZ; i++) {
+			uint8_t high = signerHexNibble(*p++);
+			uint8_t low = high == 0xFF ? 0xFF : signerHexNibble(*p++);
+			if (low == 0xFF) {
+				SIGN_DEBUG(PSTR("Malformed whitelist entry\n"));
+				return;
+			}
+			serial[i] = (high << 4) | low;
+		}
+	}
+	if (!signerWhitelistStore(nodeId, p ? serial : NULL)) {
+		SIGN_DEBUG(PSTR("Whitelist full, node %d not added\n"), nodeId);
+	} else {
+		SIGN_DEBUG(PSTR("Whitelist entry of node %d updated, %d entries\n"), nodeId, _signingWhitelistCount);
+	}
+#else
+	(void)entry;
+#endif
+}
+
 // Helper to prepare a signing presentation message
 static void prepareSigningPresentation(MyMessage &msg, uint8_t destination) {
 	// Only supports version 1 for now
@@ -112,6 +442,15 @@ static void prepareSigningPresentation(MyMessage &msg, uint8_t destination) {
 
 void signerInit(void) {
 #if defined(MY_SIGNING_FEATURE)
+	for (uint8_t i = 0; i < MY_SIGNING_SESSIONS; i++) {
+		_signingSessions[i].sender = SIGNING_SESSION_FREE;
+	}
+#if defined(MY_SIGNING_NONCE_POOL)
+	for (uint8_t i = 0; i < MY_SIGNING_NONCE_POOL_SIZE; i++) {
+		_signingIssued[i].sender = SIGNING_SESSION_FREE;
+		_signingNoncePool[i].sender = SIGNING_SESSION_FREE;
+	}
+#endif
 	// Read out the signing requirements from EEPROM
 	hwReadConfigBlock((void*)_doSign, (void*)EEPROM_SIGNING_REQUIREMENT_TABLE_ADDRESS,
 		sizeof(_doSign));
@@ -126,6 +465,9 @@ void signerInit(void) {
 #if defined(MY_SIGNING_ATSHA204)
 	signerAtsha204Init();
 #endif
+#if defined(MY_SIGNING_NODE_WHITELISTING)
+	signerWhitelistInit();
+#endif
 #endif
 }
 
@@ -175,19 +517,15 @@ bool signerProcessInternal(MyMessage &msg) {
 				nodeLock("TMNR"); //Too many nonces requested
 			}
 #endif
-#if defined(MY_SIGNING_SOFT)
-			if (signerAtsha204SoftGetNonce(msg)) {
-#endif
-#if defined(MY_SIGNING_ATSHA204)
-			if (signerAtsha204GetNonce(msg)) {
-#endif
-				SIGN_DEBUG(PSTR("Transmittng nonce\n"));
-				_sendRoute(build(msg, _nc.nodeId, msg.sender, NODE_SENSOR_ID,
-					C_INTERNAL, I_NONCE_RESPONSE, false));
-			} else {
-				SIGN_DEBUG(PSTR("Failed to generate nonce!\n"));
-			}
+			signerSendNonce(sender, I_NONCE_RESPONSE);
 			return true; // No need to further process I_NONCE_REQUEST
+#if defined(MY_SIGNING_NONCE_POOL)
+		} else if (msg.type == I_NONCE_POOL) {
+			// Keep the nonce for the next message we sign for the sender
+			SIGN_DEBUG(PSTR("Nonce received from %d. Keeping it for the next message\n"), sender);
+			signerSessionStore(_signingNoncePool, MY_SIGNING_NONCE_POOL_SIZE, sender, (uint8_t*)msg.getCustom());
+			return true; // No need to further process I_NONCE_POOL
+#endif
 		} else if (msg.type == I_SIGNING_PRESENTATION) {
 			if (msg.data[0] != SIGNING_PRESENTATION_VERSION_1) {
 				SIGN_DEBUG(PSTR("Unsupported signing presentation version (%d)!\n"), msg.data[0]);
@@ -284,10 +622,12 @@ bool signerProcessInternal(MyMessage &msg) {
 }
 
 bool signerCheckTimer(void) {
-#if defined(MY_SIGNING_SOFT)
-	return signerAtsha204SoftCheckTimer();
-#elif defined(MY_SIGNING_ATSHA204)
-	return signerAtsha204CheckTimer();
+#if defined(MY_SIGNING_FEATURE)
+	bool ok = signerSessionsPurge(_signingSessions, MY_SIGNING_SESSIONS, MY_VERIFICATION_TIMEOUT_MS);
+#if defined(MY_SIGNING_NONCE_POOL)
+	ok = signerSessionsPurge(_signingIssued, MY_SIGNING_NONCE_POOL_SIZE, MY_SIGNING_NONCE_POOL_TIMEOUT_MS) && ok;
+#endif
+	return ok;
 #else
 	return true; // Without a configured backend, we always give "positive" results
 #endif
@@ -300,6 +640,10 @@ bool signerSignMsg(MyMessage &msg) {
 	if (DO_SIGN(msg.destination) && msg.sender == _nc.nodeId) {
 		if (skipSign(msg)) {
 			return true;
+#if defined(MY_SIGNING_NONCE_POOL)
+		} else if (signerSignPooled(msg)) {
+			return true;
+#endif
 		} else {
 			// Send nonce-request
 			_signingNonceStatus=SIGN_WAITING_FOR_NONCE;
@@ -358,11 +702,18 @@ bool signerVerifyMsg(MyMessage &msg) {
 			SIGN_DEBUG(PSTR("Message is not signed, but it should have been!\n"));
 			verificationResult = false;
 		} else {
-#if defined(MY_SIGNING_SOFT)
-			verificationResult = signerAtsha204SoftVerifyMsg(msg);
-#endif
-#if defined(MY_SIGNING_ATSHA204)
-			verificationResult = signerAtsha204VerifyMsg(msg);
+			verificationResult = signerBackendVerifyMsg(msg);
+#if defined(MY_SIGNING_NONCE_POOL)
+			// The sender may have used a pre-issued nonce instead of the one it requested last
+			if (!verificationResult && signerSessionFind(_signingIssued, MY_SIGNING_NONCE_POOL_SIZE, msg.sender)) {
+				verificationResult = signerBackendVerifyMsg(msg);
+			}
+			// Hand the sender the nonce for its next signed message, unless it still holds one or the
+			// table is full. Only verified senders get one, forged messages must not make us transmit.
+			if (verificationResult && !signerSessionFind(_signingIssued, MY_SIGNING_NONCE_POOL_SIZE, msg.sender) &&
+				signerSessionFind(_signingIssued, MY_SIGNING_NONCE_POOL_SIZE, SIGNING_SESSION_FREE)) {
+				signerSendNonce(msg.sender, I_NONCE_POOL);
+			}
 #endif
 			if (!verificationResult) {
 				SIGN_DEBUG(PSTR("Signature verification failed!\n"));
@@ -398,9 +749,7 @@ void signerSha256Init(void) {
 }
 
 void signerSha256Update(const uint8_t* data, size_t sz) {
-	for (size_t i = 0; i < sz; i++) {
-		_soft_sha256.write(data[i]);
-	}
+	_soft_sha256.write(data, sz);
 }
 
 uint8_t* signerSha256Final(void) {
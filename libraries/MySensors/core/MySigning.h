@@ -342,6 +342,13 @@
  * ...
  * @endcode
  *
+ * The whitelist is kept in flash. List the entries in ascending nodeId order, then a lookup is a binary search
+ * (an unsorted list is scanned from the start on every verified message).<br>
+ * To change the whitelist without reprogramming the node, also define @ref MY_SIGNING_WHITELIST_EEPROM_SIZE. The list
+ * is then copied to EEPROM on the first start and from there on the controller edits it with @ref I_SIGNING_WHITELIST
+ * messages: "5:010203040506070809" adds (or replaces) node 5 with that serial and "5" revokes it.
+ * Nodes only accept these messages signed, from the gateway.
+ *
  * For a node that should transmit whitelisted messages but not receive whitelisted messages, you do not need any special configurations:
  * @code{.cpp}
  * #define MY_SIGNING_SOFT
@@ -495,6 +502,29 @@ typedef struct {
 /** @brief Helper macro to set that node does not require serial salted signatures */
 #define CLEAR_WHITELIST(node) (_doWhitelist[node>>3]|=(1<<node%8))
 
+#ifndef MY_SIGNING_SESSIONS
+	#if defined(MY_GATEWAY_FEATURE) || defined(MY_REPEATER_FEATURE)
+		#define MY_SIGNING_SESSIONS 4
+	#else
+		#define MY_SIGNING_SESSIONS 1
+	#endif
+#endif
+
+#ifndef MY_SIGNING_NONCE_POOL_SIZE
+	#if defined(MY_GATEWAY_FEATURE) || defined(MY_REPEATER_FEATURE)
+		#define MY_SIGNING_NONCE_POOL_SIZE 4
+	#else
+		#define MY_SIGNING_NONCE_POOL_SIZE 1
+	#endif
+#endif
+
+/** @brief Verification session, the nonce handed out to one sender */
+typedef struct {
+	uint8_t sender;             /**< @brief Node the nonce was sent to, 0xFF if the entry is free */
+	unsigned long timestamp;    /**< @brief When the nonce was sent */
+	uint8_t nonce[MAX_PAYLOAD]; /**< @brief The nonce (the rest of the 32 bytes is padding) */
+} signing_session_t;
+
 
 /**
  * @brief Initializes signing infrastructure and associated backend.
@@ -536,15 +566,45 @@ void signerPresentation(MyMessage &msg, uint8_t destination);
 bool signerProcessInternal(MyMessage &msg);
 
 /**
- * @brief Check timeout of verification session.
+ * @brief Check timeout of verification sessions.
  *
- * Nonce will be purged if it takes too long for a signed message to be sent to the receiver.
+ * Nonces will be purged if it takes too long for a signed message to be sent to the receiver.
  * \n@b Usage: This function should be called on regular intervals, typically within some process loop.
  *
- * @returns @c true if session is still valid.
+ * @returns @c true if no session expired.
  */
 bool signerCheckTimer(void);
 
+/**
+ * @brief End the verification session of a node and get its nonce (used by the signing backends).
+ *
+ * A requested nonce is returned before a pre-issued one, each call ends one session.
+ *
+ * @param sender Node that sent the signed message.
+ * @param nonce Receives the first @ref MAX_PAYLOAD bytes of the nonce.
+ * @returns @c false if there is no session for sender or it has expired.
+ */
+bool signerSessionTake(uint8_t sender, uint8_t* nonce);
+
+/**
+ * @brief Look up the serial of a node in the whitelist (used by the signing backends).
+ *
+ * @param nodeId Node to look up.
+ * @param serial Receives the @ref SHA204_SERIAL_SZ bytes of serial.
+ * @returns @c false if the node is not whitelisted.
+ */
+bool signerWhitelistLookup(uint8_t nodeId, uint8_t* serial);
+
+/**
+ * @brief Change the whitelist kept in EEPROM (@ref MY_SIGNING_WHITELIST_EEPROM_SIZE).
+ *
+ * \n@b Usage: Called with the payload of @ref I_SIGNING_WHITELIST messages from the controller.
+ * Does nothing unless the whitelist is kept in EEPROM.
+ *
+ * @param entry "nodeId" to remove the node, "nodeId:serial" with serial in hex to add or replace it.
+ */
+void signerWhitelistUpdate(const char* entry);
+
 /**
  * @brief Get nonce from provided message and store for signing operations.
  *
@@ -32,18 +32,12 @@
 // Define MY_DEBUG_VERBOSE_SIGNING in your sketch to enable signing backend debugprints
 
 ATSHA204Class atsha204(MY_SIGNING_ATSHA204_PIN);
-unsigned long _signing_timestamp;
-bool _signing_verification_ongoing = false;
 uint8_t _signing_current_nonce[NONCE_NUMIN_SIZE_PASSTHROUGH+SHA204_SERIAL_SZ+1];
 uint8_t _signing_temp_message[SHA_MSG_SIZE];
 uint8_t _singning_rx_buffer[SHA204_RSP_SIZE_MAX];
 uint8_t _singning_tx_buffer[SHA204_CMD_SIZE_MAX];
 extern uint8_t _doWhitelist[32];
 
-#ifdef MY_SIGNING_NODE_WHITELISTING
-	const whitelist_entry_t _signing_whitelist[] = MY_SIGNING_NODE_WHITELISTING;
-#endif
-
 static void signerCalculateSignature(MyMessage &msg);
 static uint8_t* signerSha256(const uint8_t* data, size_t sz);
 
@@ -89,19 +83,6 @@ static void DEBUG_SIGNING_PRINTBUF(const __FlashStringHelper* str, uint8_t* buf,
 void signerAtsha204Init(void) {
 }
 
-bool signerAtsha204CheckTimer(void) {
-	if (_signing_verification_ongoing) {
-		if (millis() < _signing_timestamp || millis() > _signing_timestamp + MY_VERIFICATION_TIMEOUT_MS) {
-			DEBUG_SIGNING_PRINTBUF(F("Verification timeout"), NULL, 0);
-			// Purge nonce
-			memset(_signing_current_nonce, 0x00, NONCE_NUMIN_SIZE_PASSTHROUGH);
-			_signing_verification_ongoing = false;
-			return false; 
-		}
-	}
-	return true;
-}
-
 bool signerAtsha204GetNonce(MyMessage &msg) {
 	DEBUG_SIGNING_PRINTBUF(F("Signing backend: ATSHA204"), NULL, 0);
 	// Generate random number for use as nonce
@@ -122,12 +103,6 @@ bool signerAtsha204GetNonce(MyMessage &msg) {
 
 	// Transfer the first part of the nonce to the message
 	msg.set(_signing_current_nonce, MAX_PAYLOAD);
-	_signing_verification_ongoing = true;
-	_signing_timestamp = millis(); // Set timestamp to determine when to purge nonce
-	// Be a little fancy to handle turnover (prolong the time allowed to timeout after turnover)
-	// Note that if message is "too" quick, and arrives before turnover, it will be rejected
-	// but this is consider such a rare case that it is accepted and rejects are 'safe'
-	if (_signing_timestamp + MY_VERIFICATION_TIMEOUT_MS < millis()) _signing_timestamp = 0;
 	return true;
 }
 
@@ -170,16 +145,12 @@ bool signerAtsha204SignMsg(MyMessage &msg) {
 }
 
 bool signerAtsha204VerifyMsg(MyMessage &msg) {
-	if (!_signing_verification_ongoing) {
+	// Fetch (and expire) the nonce we sent to this sender
+	if (!signerSessionTake(msg.sender, _signing_current_nonce)) {
 		DEBUG_SIGNING_PRINTBUF(F("No active verification session"), NULL, 0);
 		return false; 
 	} else {
-		// Make sure we have not expired
-		if (!signerCheckTimer()) {
-			return false; 
-		}
-
-		_signing_verification_ongoing = false;
+		memset(&_signing_current_nonce[MAX_PAYLOAD], 0xAA, sizeof(_signing_current_nonce)-MAX_PAYLOAD);
 
 		if (msg.data[mGetLength(msg)] != SIGNING_IDENTIFIER) {
 			DEBUG_SIGNING_PRINTBUF(F("Incorrect signing identifier"), NULL, 0);
@@ -191,21 +162,14 @@ bool signerAtsha204VerifyMsg(MyMessage &msg) {
 
 #ifdef MY_SIGNING_NODE_WHITELISTING
 		// Look up the senders nodeId in our whitelist and salt the signature with that data
-		size_t j;
-		for (j=0; j < NUM_OF(_signing_whitelist); j++) {
-			if (_signing_whitelist[j].nodeId == msg.sender) {
-				DEBUG_SIGNING_PRINTBUF(F("Sender found in whitelist"), NULL, 0);
-				memcpy(_signing_current_nonce, &_singning_rx_buffer[SHA204_BUFFER_POS_DATA], 32); // We can reuse the nonce buffer now since it is no longer needed
-				_signing_current_nonce[32] = msg.sender;
-				memcpy(&_signing_current_nonce[33], _signing_whitelist[j].serial, SHA204_SERIAL_SZ);
-				(void)signerSha256(_signing_current_nonce, 32+1+SHA204_SERIAL_SZ); // we can 'void' sha256 because the hash is already put in the correct place
-				break;
-			}
-		}
-		if (j == NUM_OF(_signing_whitelist)) {
+		if (!signerWhitelistLookup(msg.sender, &_signing_current_nonce[33])) {
 			DEBUG_SIGNING_PRINTBUF(F("Sender not found in whitelist, message rejected!"), NULL, 0);
 			return false;
 		}
+		DEBUG_SIGNING_PRINTBUF(F("Sender found in whitelist"), NULL, 0);
+		memcpy(_signing_current_nonce, &_singning_rx_buffer[SHA204_BUFFER_POS_DATA], 32); // We can reuse the nonce buffer now since it is no longer needed
+		_signing_current_nonce[32] = msg.sender;
+		(void)signerSha256(_signing_current_nonce, 32+1+SHA204_SERIAL_SZ); // we can 'void' sha256 because the hash is already put in the correct place
 #endif
 
 		// Overwrite the first byte in the signature with the signing identifier
@@ -36,19 +36,12 @@
 // Define MY_DEBUG_VERBOSE_SIGNING in your sketch to enable signing backend debugprints
 
 Sha256Class _signing_sha256;
-unsigned long _signing_timestamp;
-bool _signing_verification_ongoing = false;
 uint8_t _signing_current_nonce[NONCE_NUMIN_SIZE_PASSTHROUGH];
 uint8_t _signing_temp_message[32];
-static uint8_t _signing_hmac_key[32];
 uint8_t _signing_hmac[32];
 extern uint8_t _doWhitelist[32];
 
 static uint8_t _signing_node_serial_info[9];
-#ifdef MY_SIGNING_NODE_WHITELISTING
-	const whitelist_entry_t _signing_whitelist[] = MY_SIGNING_NODE_WHITELISTING;
-#endif
-
 static void signerCalculateSignature(MyMessage &msg);
 
 #ifdef MY_DEBUG_VERBOSE_SIGNING
@@ -93,23 +86,14 @@ void signerAtsha204SoftInit(void) {
 	// initialize pseudo-RNG
 	randomSeed(analogRead(MY_SIGNING_SOFT_RANDOMSEED_PIN));
 	// Set secrets
-	hwReadConfigBlock((void*)_signing_hmac_key, (void*)EEPROM_SIGNING_SOFT_HMAC_KEY_ADDRESS, 32);
+	// Only the hashed key blocks are kept, not the key itself
+	uint8_t key[32];
+	hwReadConfigBlock((void*)key, (void*)EEPROM_SIGNING_SOFT_HMAC_KEY_ADDRESS, 32);
+	_signing_sha256.setHmacKey(key, 32);
+	memset(key, 0, sizeof(key));
 	hwReadConfigBlock((void*)_signing_node_serial_info, (void*)EEPROM_SIGNING_SOFT_SERIAL_ADDRESS, 9);
 }
 
-bool signerAtsha204SoftCheckTimer(void) {
-	if (_signing_verification_ongoing) {
-		if (millis() < _signing_timestamp || millis() > _signing_timestamp + MY_VERIFICATION_TIMEOUT_MS) {
-			DEBUG_SIGNING_PRINTBUF(F("Verification timeout"), NULL, 0);
-			// Purge nonce
-			memset(_signing_current_nonce, 0xAA, 32);
-			_signing_verification_ongoing = false;
-			return false; 
-		}
-	}
-	return true;
-}
-
 bool signerAtsha204SoftGetNonce(MyMessage &msg) {
 	DEBUG_SIGNING_PRINTBUF(F("Signing backend: ATSHA204Soft"), NULL, 0);
 
@@ -127,12 +111,6 @@ bool signerAtsha204SoftGetNonce(MyMessage &msg) {
 
 	// Transfer the first part of the nonce to the message
 	msg.set(_signing_current_nonce, MAX_PAYLOAD);
-	_signing_verification_ongoing = true;
-	_signing_timestamp = millis(); // Set timestamp to determine when to purge nonce
-	// Be a little fancy to handle turnover (prolong the time allowed to timeout after turnover)
-	// Note that if message is "too" quick, and arrives before turnover, it will be rejected
-	// but this is consider such a rare case that it is accepted and rejects are 'safe'
-	if (_signing_timestamp + MY_VERIFICATION_TIMEOUT_MS < millis()) _signing_timestamp = 0;
 	return true;
 }
 
@@ -158,9 +136,9 @@ bool signerAtsha204SoftSignMsg(MyMessage &msg) {
 	if (DO_WHITELIST(msg.destination)) {
 		// Salt the signature with the senders nodeId and the (hopefully) unique serial The Creator has provided
 		_signing_sha256.init();
-		for (int i=0; i<32; i++) _signing_sha256.write(_signing_hmac[i]);
+		_signing_sha256.write(_signing_hmac, 32);
 		_signing_sha256.write(msg.sender);
-		for (int i=0; i<SHA204_SERIAL_SZ; i++) _signing_sha256.write(_signing_node_serial_info[i]);
+		_signing_sha256.write(_signing_node_serial_info, SHA204_SERIAL_SZ);
 		memcpy(_signing_hmac, _signing_sha256.result(), 32);
 		DEBUG_SIGNING_PRINTBUF(F("SHA256: "), _signing_hmac, 32);
 		DEBUG_SIGNING_PRINTBUF(F("Signature salted with serial"), NULL, 0);
@@ -177,16 +155,12 @@ bool signerAtsha204SoftSignMsg(MyMessage &msg) {
 }
 
 bool signerAtsha204SoftVerifyMsg(MyMessage &msg) {
-	if (!_signing_verification_ongoing) {
+	// Fetch (and expire) the nonce we sent to this sender
+	if (!signerSessionTake(msg.sender, _signing_current_nonce)) {
 		DEBUG_SIGNING_PRINTBUF(F("No active verification session"), NULL, 0);
 		return false; 
 	} else {
-		// Make sure we have not expired
-		if (!signerCheckTimer()) {
-			return false; 
-		}
-
-		_signing_verification_ongoing = false;
+		memset(&_signing_current_nonce[MAX_PAYLOAD], 0xAA, sizeof(_signing_current_nonce)-MAX_PAYLOAD);
 
 		if (msg.data[mGetLength(msg)] != SIGNING_IDENTIFIER) {
 			DEBUG_SIGNING_PRINTBUF(F("Incorrect signing identifier"), NULL, 0);
@@ -199,23 +173,18 @@ bool signerAtsha204SoftVerifyMsg(MyMessage &msg) {
 
 #ifdef MY_SIGNING_NODE_WHITELISTING
 		// Look up the senders nodeId in our whitelist and salt the signature with that data
-		size_t j;
-		for (j=0; j < NUM_OF(_signing_whitelist); j++) {
-			if (_signing_whitelist[j].nodeId == msg.sender) {
-				DEBUG_SIGNING_PRINTBUF(F("Sender found in whitelist"), NULL, 0);
-				_signing_sha256.init();
-				for (int i=0; i<32; i++) _signing_sha256.write(_signing_hmac[i]);
-				_signing_sha256.write(msg.sender);
-				for (int i=0; i<SHA204_SERIAL_SZ; i++) _signing_sha256.write(_signing_whitelist[j].serial[i]);
-				memcpy(_signing_hmac, _signing_sha256.result(), 32);
-				DEBUG_SIGNING_PRINTBUF(F("SHA256: "), _signing_hmac, 32);
-				break;
-			}
-		}
-		if (j == NUM_OF(_signing_whitelist)) {
+		uint8_t serial[SHA204_SERIAL_SZ];
+		if (!signerWhitelistLookup(msg.sender, serial)) {
 			DEBUG_SIGNING_PRINTBUF(F("Sender not found in whitelist, message rejected!"), NULL, 0);
 			return false;
 		}
+		DEBUG_SIGNING_PRINTBUF(F("Sender found in whitelist"), NULL, 0);
+		_signing_sha256.init();
+		_signing_sha256.write(_signing_hmac, 32);
+		_signing_sha256.write(msg.sender);
+		_signing_sha256.write(serial, SHA204_SERIAL_SZ);
+		memcpy(_signing_hmac, _signing_sha256.result(), 32);
+		DEBUG_SIGNING_PRINTBUF(F("SHA256: "), _signing_hmac, 32);
 #endif
 
 		// Overwrite the first byte in the signature with the signing identifier
@@ -264,36 +233,39 @@ static void signerCalculateSignature(MyMessage &msg) {
 	// 25 bytes zeroes
 	// 32 bytes nonce
 
+	uint8_t fields[32]; // The constant parts, fed to the hash in as few writes as possible
+
 	// Calculate message digest first
+	memset(fields, 0, sizeof(fields));
+	fields[0] = 0x15; // OPCODE
+	fields[1] = 0x02; // param1
+	fields[2] = 0x08; // param2(1)
+	fields[3] = 0x00; // param2(2)
+	fields[4] = 0xEE; // SN[8]
+	fields[5] = 0x01; // SN[0]
+	fields[6] = 0x23; // SN[1]
 	_signing_sha256.init();
-	for (int i=0; i<32; i++) _signing_sha256.write(_signing_temp_message[i]);
-	_signing_sha256.write(0x15); // OPCODE
-	_signing_sha256.write(0x02); // param1
-	_signing_sha256.write(0x08); // param2(1)
-	_signing_sha256.write(0x00); // param2(2)
-	_signing_sha256.write(0xEE); // SN[8]
-	_signing_sha256.write(0x01); // SN[0]
-	_signing_sha256.write(0x23); // SN[1]
-	for (int i=0; i<25; i++) _signing_sha256.write(0x00);
-	for (int i=0; i<32; i++) _signing_sha256.write(_signing_current_nonce[i]);
+	_signing_sha256.write(_signing_temp_message, 32);
+	_signing_sha256.write(fields, 32); // Including 25 bytes zeroes
+	_signing_sha256.write(_signing_current_nonce, 32);
 	// Purge nonce when used
 	memset(_signing_current_nonce, 0xAA, 32);
 	memcpy(_signing_temp_message, _signing_sha256.result(), 32);
 
 	// Feed "message" to HMAC calculator
-	_signing_sha256.initHmac(_signing_hmac_key,32); // Set the key to use
-	for (int i=0; i<32; i++) _signing_sha256.write(0x00); // 32 bytes zeroes
-	for (int i=0; i<32; i++) _signing_sha256.write(_signing_temp_message[i]); // 32 bytes digest
-	_signing_sha256.write(0x11); // OPCODE
-	_signing_sha256.write(0x04); // Mode
-	_signing_sha256.write(0x00); // SlotID(1)
-	_signing_sha256.write(0x00); // SlotID(2)
-	for (int i=0; i<11; i++) _signing_sha256.write(0x00); // 11 bytes zeroes
-	_signing_sha256.write(0xEE); // SN[8]
-	for (int i=0; i<4; i++) _signing_sha256.write(0x00); // 4 bytes zeroes
-	_signing_sha256.write(0x01); // SN[0]
-	_signing_sha256.write(0x23); // SN[1]
-	for (int i=0; i<2; i++) _signing_sha256.write(0x00); // 2 bytes zeroes
+	_signing_sha256.initHmac(); // Continues from the key hashed in signerAtsha204SoftInit()
+	memset(fields, 0, sizeof(fields));
+	_signing_sha256.write(fields, 32); // 32 bytes zeroes
+	_signing_sha256.write(_signing_temp_message, 32); // 32 bytes digest
+	fields[0] = 0x11; // OPCODE
+	fields[1] = 0x04; // Mode
+	// SlotID(1), SlotID(2) and 11 bytes zeroes
+	fields[15] = 0xEE; // SN[8]
+	// 4 bytes zeroes
+	fields[20] = 0x01; // SN[0]
+	fields[21] = 0x23; // SN[1]
+	// 2 bytes zeroes
+	_signing_sha256.write(fields, 24);
 
 	memcpy(_signing_hmac, _signing_sha256.resultHmac(), 32);
 
@@ -0,0 +1,133 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+// Wear-leveled saveState()/loadState() for positions below MY_STATE_LOG_SLOTS.
+//
+// The log is a ring of two byte records {marker, value} at EEPROM_STATE_LOG_ADDRESS. The
+// marker holds the position (bits 0-6) and a lap bit (bit 7) that flips every time the
+// writer wraps around, so the write head is where the lap bit changes. A record that is
+// about to be overwritten while it still holds the latest value of its position is
+// rewritten at the head first (only its marker changes). Every cell is thus written once
+// per lap, whatever position the sketch saves.
+
+#define STATE_LOG_RECORDS (MY_STATE_LOG_SIZE / 2)
+#define STATE_LOG_NONE 0xFF
+
+#if MY_STATE_LOG_SLOTS > 127
+	#error MY_STATE_LOG_SLOTS must be 127 or less
+#endif
+#if STATE_LOG_RECORDS <= MY_STATE_LOG_SLOTS || STATE_LOG_RECORDS > 255
+	#error MY_STATE_LOG_SIZE must hold more records than MY_STATE_LOG_SLOTS (and at most 255)
+#endif
+#if EEPROM_STATE_LOG_ADDRESS + MY_STATE_LOG_SIZE > EEPROM_CONFIG_SIZE
+	#error MY_STATE_LOG_SIZE does not fit in EEPROM
+#endif
+#if defined(MY_RF24_ENCRYPTION_CCM) && EEPROM_STATE_LOG_ADDRESS + MY_STATE_LOG_SIZE > EEPROM_RF24_COUNTER_ADDRESS
+	#error MY_STATE_LOG_SIZE overlaps the MY_RF24_ENCRYPTION_CCM frame counter (last 2 bytes of EEPROM)
+#endif
+
+uint8_t _stateValue[MY_STATE_LOG_SLOTS]; // Latest value of each position
+uint8_t _stateRecord[MY_STATE_LOG_SLOTS]; // Record holding it, STATE_LOG_NONE if never logged
+uint8_t _stateLogHead; // Next record to write
+uint8_t _stateLogLap; // Lap bit of the records being written (0x00 or 0x80)
+bool _stateLogReady;
+
+static inline int stateLogAddress(uint8_t record) {
+	return EEPROM_STATE_LOG_ADDRESS + record * 2;
+}
+
+// Find the head and replay the log from the oldest record to the newest
+static void stateLogInit() {
+	_stateLogReady = true;
+	uint8_t firstLap = hwReadConfig(stateLogAddress(0)) & 0x80;
+	_stateLogHead = 0;
+	for (uint8_t i = 1; i < STATE_LOG_RECORDS; i++) {
+		if ((hwReadConfig(stateLogAddress(i)) & 0x80) != firstLap) {
+			_stateLogHead = i;
+			break;
+		}
+	}
+	// All records on the same lap: the last one written was at the end of the ring
+	_stateLogLap = _stateLogHead ? firstLap : firstLap ^ 0x80;
+
+	memset(_stateRecord, STATE_LOG_NONE, sizeof(_stateRecord));
+	uint8_t record = _stateLogHead;
+	for (uint8_t i = 0; i < STATE_LOG_RECORDS; i++) {
+		uint8_t pos = hwReadConfig(stateLogAddress(record)) & 0x7F;
+		if (pos < MY_STATE_LOG_SLOTS) {
+			_stateRecord[pos] = record;
+			_stateValue[pos] = hwReadConfig(stateLogAddress(record) + 1);
+		}
+		if (++record == STATE_LOG_RECORDS) {
+			record = 0;
+		}
+	}
+	for (uint8_t pos = 0; pos < MY_STATE_LOG_SLOTS; pos++) {
+		if (_stateRecord[pos] == STATE_LOG_NONE) {
+			// Not logged yet, start from what the sketch saved before the log was enabled
+			_stateValue[pos] = hwReadConfig(EEPROM_LOCAL_CONFIG_ADDRESS+pos);
+		}
+	}
+}
+
+static void stateLogAppend(uint8_t pos, uint8_t value) {
+	while (true) {
+		uint8_t record = _stateLogHead;
+		uint8_t lap = _stateLogLap;
+		if (++_stateLogHead == STATE_LOG_RECORDS) {
+			_stateLogHead = 0;
+			_stateLogLap ^= 0x80;
+		}
+		uint8_t current = hwReadConfig(stateLogAddress(record)) & 0x7F;
+		if (current < MY_STATE_LOG_SLOTS && current != pos && _stateRecord[current] == record) {
+			// Latest value of another position, carry it over into this lap
+			hwWriteConfig(stateLogAddress(record), lap | current);
+			continue;
+		}
+		// Value first, the marker makes the record valid
+		hwWriteConfig(stateLogAddress(record) + 1, value);
+		hwWriteConfig(stateLogAddress(record), lap | pos);
+		_stateRecord[pos] = record;
+		_stateValue[pos] = value;
+		return;
+	}
+}
+
+void saveState(uint8_t pos, uint8_t value) {
+	if (pos >= MY_STATE_LOG_SLOTS) {
+		hwWriteConfig(EEPROM_LOCAL_CONFIG_ADDRESS+pos, value);
+		return;
+	}
+	if (!_stateLogReady) {
+		stateLogInit();
+	}
+	if (_stateValue[pos] != value) {
+		stateLogAppend(pos, value);
+	}
+}
+
+uint8_t loadState(uint8_t pos) {
+	if (pos >= MY_STATE_LOG_SLOTS) {
+		return hwReadConfig(EEPROM_LOCAL_CONFIG_ADDRESS+pos);
+	}
+	if (!_stateLogReady) {
+		stateLogInit();
+	}
+	return _stateValue[pos];
+}
@@ -22,14 +22,73 @@
 
 bool _autoFindParent;
 uint8_t _failedTransmissions;
+transport_state _transportState;
+unsigned long _transportStateTime; // When _transportState was entered
+uint8_t _searchParent; // Best parent found by the running search
+uint8_t _searchDistance; // Distance to the gateway through _searchParent
+#if defined(MY_ASYNC_TRANSPORT_FEATURE)
+	bool _transportPresented;
+#endif
+
+#if defined(MY_RX_MESSAGE_BUFFER_FEATURE)
+	RxFrame _rxBuffer[MY_RX_MESSAGE_BUFFER_SIZE];
+	uint8_t _rxBufferHead; // Oldest frame
+	uint8_t _rxBufferCount; // Number of buffered frames
+	uint16_t _rxBufferOverflows; // Times the buffer was full with frames still waiting in the radio
+#endif
+
+#if defined(MY_MESSAGE_SEQUENCE_FEATURE)
+	uint8_t _sequence; // Last sequence number given to a message from this node
+	bool _msgSequenced; // _msg arrived with a sequence number (kept in data[length] when relayed)
+	SequenceWindowEntry _sequenceWindow[MY_SEQUENCE_WINDOW_SIZE]; // Recently seen messages, per sender
+#endif
+
+#if defined(MY_LINK_STATS_FEATURE)
+	LinkStats _linkStats[MY_LINK_STATS_SIZE]; // Unused entries have nodeId AUTO
+	#if defined(MY_LINK_STATS_REPORT_INTERVAL)
+		unsigned long _linkStatsReportTime; // Last periodic report
+	#endif
+#endif
+
+#if defined(MY_REPEATER_FEATURE) && defined(MY_RAM_ROUTING_TABLE_FEATURE)
+	uint8_t _routes[256]; // Next hop for each node, mirrors EEPROM_ROUTES_ADDRESS
+	bool _routesDirty; // Table differs from EEPROM
+	unsigned long _routesChangeTime; // First change since last save
+#endif
 
 #ifdef MY_OTA_FIRMWARE_FEATURE
+	#if MY_OTA_WINDOW_SIZE < 1 || MY_OTA_WINDOW_SIZE > 32
+		#error MY_OTA_WINDOW_SIZE must be between 1 and 32
+	#endif
+	#if MAX_PAYLOAD < 6 + FIRMWARE_BLOCK_SIZE
+		// sizeof(ReplyFWBlock), usable by the preprocessor
+		#error MAX_PAYLOAD is too small for firmware blocks (MY_RF24_ENCRYPTION_MAC_SIZE must be 0)
+	#endif
 	SPIFlash _flash(MY_OTA_FLASH_SS, MY_OTA_FLASH_JDECID);
 	NodeFirmwareConfig _fc;
 	bool _fwUpdateOngoing;
-	unsigned long _fwLastRequestTime;
-	uint16_t _fwBlock;
+	unsigned long _fwLastRequestTime; // Last block request, outstanding ones are repeated MY_OTA_RETRY_DELAY after it
+	uint16_t _fwBlocks; // Blocks to fetch, _fc.blocks unless the image is encoded
+	uint16_t _fwBlock; // First block not in flash yet, blocks are fetched from the bottom up
+	uint16_t _fwCrc; // Checksum of the image up to _fwBlock (or _fwOutput)
+	uint32_t _fwReceived; // Blocks of the window written to flash
+	uint32_t _fwRequested; // Blocks of the window requested and not received yet
 	uint8_t _fwRetry;
+	#if defined(MY_OTA_COMPRESSION_FEATURE)
+		#if defined(hwReadFirmwareBlock)
+			uint8_t _fwEncodings = FIRMWARE_ENCODING_LZ | FIRMWARE_ENCODING_DELTA; // Offered to the controller
+		#else
+			uint8_t _fwEncodings = FIRMWARE_ENCODING_LZ;
+		#endif
+		uint8_t _fwEncoding; // Encoding of the image being fetched, 0 if it comes as is
+		uint16_t _fwOutput; // Bytes decoded so far
+		uint8_t _fwOutputBuffer[FIRMWARE_BLOCK_SIZE]; // Last decoded bytes, not written to flash yet
+		uint8_t _fwOutputLength;
+		uint8_t _fwToken; // Token being decoded, see FIRMWARE_TOKEN_*
+		uint8_t _fwTokenBytes; // Argument bytes of _fwToken still to come
+		uint16_t _fwTokenLength; // Literals still to come or bytes to copy
+		uint16_t _fwTokenArgument; // Distance or address to copy from
+	#endif
 #endif
 
 
@@ -38,38 +97,515 @@ static inline bool isValidDistance( const uint8_t distance ) {
 }
 
 
-inline void transportProcess() {
-	uint8_t to = 0;
-	if (!transportAvailable(&to))
-	{
-		#ifdef MY_OTA_FIRMWARE_FEATURE
-		unsigned long enter = hwMillis();
-		if (_fwUpdateOngoing && (enter - _fwLastRequestTime > MY_OTA_RETRY_DELAY)) {
-			if (!_fwRetry) {
-				debug(PSTR("fw upd fail\n"));
-				// Give up. We have requested MY_OTA_RETRY times without any packet in return.
-				_fwUpdateOngoing = false;
-				ledBlinkErr(1);
-				return;
+#if defined(MY_RX_MESSAGE_BUFFER_FEATURE)
+// Move everything the radio has received into the buffer
+static void transportRxBufferFill() {
+	uint8_t to;
+	while (_rxBufferCount < MY_RX_MESSAGE_BUFFER_SIZE && transportAvailable(&to)) {
+		RxFrame &frame = _rxBuffer[(_rxBufferHead + _rxBufferCount) % MY_RX_MESSAGE_BUFFER_SIZE];
+		frame.to = to;
+		frame.length = transportReceive(frame.data);
+		_rxBufferCount++;
+	}
+	if (_rxBufferCount == MY_RX_MESSAGE_BUFFER_SIZE && transportAvailable(&to)) {
+		// Leave the rest in the radio, it stops acking once its own FIFO is full
+		_rxBufferOverflows++;
+	}
+}
+
+// Copy oldest buffered frame to message
+static bool transportRxBufferRead(uint8_t *to, uint8_t *length, MyMessage &message) {
+	if (!_rxBufferCount) {
+		return false;
+	}
+	RxFrame &frame = _rxBuffer[_rxBufferHead];
+	*to = frame.to;
+	*length = frame.length;
+	memcpy((void *)&message, frame.data, min(frame.length, sizeof(MyMessage)));
+	_rxBufferHead = (_rxBufferHead + 1) % MY_RX_MESSAGE_BUFFER_SIZE;
+	_rxBufferCount--;
+	return true;
+}
+
+uint16_t transportRxBufferOverflows() {
+	return _rxBufferOverflows;
+}
+#endif
+
+#if defined(MY_REPEATER_FEATURE)
+#if defined(MY_RAM_ROUTING_TABLE_FEATURE)
+void transportLoadRoutes() {
+	hwReadConfigBlock((void*)_routes, (void*)EEPROM_ROUTES_ADDRESS, sizeof(_routes));
+	_routesDirty = false;
+}
+
+uint8_t transportGetRoute(uint8_t node) {
+	return _routes[node];
+}
+
+void transportSetRoute(uint8_t node, uint8_t route) {
+	if (_routes[node] != route) {
+		_routes[node] = route;
+		if (!_routesDirty) {
+			_routesDirty = true;
+			_routesChangeTime = hwMillis();
+		}
+	}
+}
+
+void transportSaveRoutes() {
+	if (!_routesDirty) {
+		return;
+	}
+	// hwWriteConfig() only writes cells that differ
+	uint8_t i = 255;
+	do {
+		hwWriteConfig(EEPROM_ROUTES_ADDRESS+i, _routes[i]);
+	} while (i--);
+	_routesDirty = false;
+}
+
+void transportRoutesProcess() {
+	if (_routesDirty && hwMillis() - _routesChangeTime > MY_ROUTING_TABLE_SAVE_DELAY) {
+		transportSaveRoutes();
+	}
+}
+
+void transportClearRoutes() {
+	memset(_routes, BROADCAST_ADDRESS, sizeof(_routes));
+	_routesDirty = true;
+	transportSaveRoutes();
+}
+#else
+uint8_t transportGetRoute(uint8_t node) {
+	return hwReadConfig(EEPROM_ROUTES_ADDRESS+node);
+}
+
+void transportSetRoute(uint8_t node, uint8_t route) {
+	hwWriteConfig(EEPROM_ROUTES_ADDRESS+node, route);
+}
+
+void transportSaveRoutes() {
+	// Every change is written immediately
+}
+
+void transportClearRoutes() {
+	uint8_t i = 255;
+	do {
+		hwWriteConfig(EEPROM_ROUTES_ADDRESS+i, BROADCAST_ADDRESS);
+	} while (i--);
+}
+#endif
+#endif
+
+#ifdef MY_OTA_FIRMWARE_FEATURE
+// CRC-16 (0xA001 reflected) of each nibble value, half a byte at a time keeps the table at 32 bytes
+static const uint16_t _fwCrcTable[16] PROGMEM = {
+	0x0000, 0xCC01, 0xD801, 0x1400, 0xF001, 0x3C00, 0x2800, 0xE401,
+	0xA001, 0x6C00, 0x7800, 0xB401, 0x5000, 0x9C01, 0x8801, 0x4400
+};
+
+static uint16_t transportFirmwareCrc(uint16_t crc, const uint8_t* data, uint16_t length) {
+	while (length--) {
+		crc ^= *data++;
+		crc = (crc >> 4) ^ pgm_read_word(&_fwCrcTable[crc & 0x0F]);
+		crc = (crc >> 4) ^ pgm_read_word(&_fwCrcTable[crc & 0x0F]);
+	}
+	return crc;
+}
+
+// Bit of block in the _fwReceived/_fwRequested window bitmaps, the window starts at block _fwBlock and goes up
+static inline uint32_t transportFirmwareBit(uint16_t block) {
+	return (uint32_t)1 << (block - _fwBlock);
+}
+
+// Where a fetched block is kept, an encoded image is decoded from there into the image area
+static inline uint32_t transportFirmwareBlockAddress(uint16_t block) {
+	#if defined(MY_OTA_COMPRESSION_FEATURE)
+		if (_fwEncoding) {
+			return FIRMWARE_STREAM_OFFSET + (uint32_t)block * FIRMWARE_BLOCK_SIZE;
+		}
+	#endif
+	return FIRMWARE_START_OFFSET + (uint32_t)block * FIRMWARE_BLOCK_SIZE;
+}
+
+void transportRequestFirmwareConfig() {
+	RequestFirmwareConfig *reqFWConfig = (RequestFirmwareConfig *)_msg.data;
+	#if defined(MY_OTA_COMPRESSION_FEATURE)
+		mSetLength(_msg, sizeof(RequestFirmwareConfig));
+		reqFWConfig->encodings = _fwEncodings;
+	#else
+		mSetLength(_msg, offsetof(RequestFirmwareConfig, encodings));
+	#endif
+	mSetCommand(_msg, C_STREAM);
+	mSetPayloadType(_msg,P_CUSTOM);
+	// copy node settings to reqFWConfig
+	memcpy(reqFWConfig,&_fc,sizeof(NodeFirmwareConfig));
+	// add bootloader information
+	reqFWConfig->BLVersion = MY_OTA_BOOTLOADER_VERSION;
+	_fwUpdateOngoing = false;
+	_sendRoute(build(_msg, _nc.nodeId, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_STREAM, ST_FIRMWARE_CONFIG_REQUEST, false));
+}
+
+// Drops the update, the controller can offer it again
+static void transportFirmwareFailed() {
+	_fwUpdateOngoing = false;
+	ledBlinkErr(1);
+	hwReadConfigBlock((void*)&_fc, (void*)EEPROM_FIRMWARE_TYPE_ADDRESS, sizeof(NodeFirmwareConfig));
+	#if defined(MY_OTA_COMPRESSION_FEATURE)
+		if (_fwEncoding & FIRMWARE_ENCODING_DELTA) {
+			// The running firmware was not the one the delta was made for, ask for the whole image
+			_fwEncodings &= ~FIRMWARE_ENCODING_DELTA;
+			transportRequestFirmwareConfig();
+		}
+	#endif
+}
+
+#if defined(MY_OTA_COMPRESSION_FEATURE)
+// Writes the decoded bytes kept in RAM to flash, taking the checksum on the way
+static void transportFirmwareFlush() {
+	if (_fwOutputLength) {
+		_flash.writeBytes(FIRMWARE_START_OFFSET + _fwOutput - _fwOutputLength, _fwOutputBuffer, _fwOutputLength);
+		_fwCrc = transportFirmwareCrc(_fwCrc, _fwOutputBuffer, _fwOutputLength);
+		_fwOutputLength = 0;
+	}
+}
+
+static bool transportFirmwareOutput(const uint8_t* data, uint16_t length) {
+	if (_fwOutput + (uint32_t)length > (uint32_t)_fc.blocks * FIRMWARE_BLOCK_SIZE) {
+		return false;
+	}
+	while (length--) {
+		_fwOutputBuffer[_fwOutputLength++] = *data++;
+		_fwOutput++;
+		if (_fwOutputLength == FIRMWARE_BLOCK_SIZE) {
+			transportFirmwareFlush();
+		}
+	}
+	return true;
+}
+
+// Copies _fwTokenLength bytes from _fwTokenArgument bytes back, or from the running firmware
+static bool transportFirmwareCopy() {
+	uint8_t data[FIRMWARE_BLOCK_SIZE];
+	bool base = _fwToken >= FIRMWARE_TOKEN_BASE;
+	if (!base && (!_fwTokenArgument || _fwTokenArgument > _fwOutput)) {
+		return false;
+	}
+	uint16_t from = base ? _fwTokenArgument : _fwOutput - _fwTokenArgument;
+	while (_fwTokenLength) {
+		uint8_t length = _fwTokenLength < FIRMWARE_BLOCK_SIZE ? _fwTokenLength : FIRMWARE_BLOCK_SIZE;
+		if (base) {
+			#if defined(hwReadFirmwareBlock)
+				hwReadFirmwareBlock(data, from, length);
+			#endif
+		} else {
+			// A copy overlapping its own output repeats the last _fwTokenArgument bytes
+			if (length > _fwTokenArgument) {
+				length = _fwTokenArgument;
+			}
+			transportFirmwareFlush();
+			_flash.readBytes(FIRMWARE_START_OFFSET + from, data, length);
+		}
+		if (!transportFirmwareOutput(data, length)) {
+			return false;
+		}
+		from += length;
+		_fwTokenLength -= length;
+	}
+	return true;
+}
+
+// Feeds the next bytes of an encoded image to the decoder, false if they make no sense
+static bool transportFirmwareDecode(const uint8_t* data, uint8_t length) {
+	while (length) {
+		if (_fwTokenBytes) {
+			// Arguments of a copy, the length (base copies only) comes first
+			_fwTokenBytes--;
+			if (_fwToken >= FIRMWARE_TOKEN_BASE && _fwTokenBytes == 2) {
+				_fwTokenLength = ((uint16_t)(_fwToken & 0x3F) << 8 | *data) + 1;
+			} else {
+				_fwTokenArgument = _fwTokenArgument << 8 | *data;
+			}
+			data++;
+			length--;
+			if (!_fwTokenBytes && !transportFirmwareCopy()) {
+				return false;
 			}
-			_fwRetry--;
+		} else if (_fwTokenLength) {
+			uint8_t literals = _fwTokenLength < length ? _fwTokenLength : length;
+			if (!transportFirmwareOutput(data, literals)) {
+				return false;
+			}
+			_fwTokenLength -= literals;
+			data += literals;
+			length -= literals;
+		} else if (_fwOutput == _fc.blocks * FIRMWARE_BLOCK_SIZE) {
+			// Padding of the last block
+			return true;
+		} else {
+			_fwToken = *data++;
+			length--;
+			_fwTokenArgument = 0;
+			if (_fwToken < FIRMWARE_TOKEN_MATCH) {
+				_fwTokenLength = _fwToken - FIRMWARE_TOKEN_LITERAL + 1;
+			} else if (_fwToken < FIRMWARE_TOKEN_BASE) {
+				_fwTokenLength = (_fwToken & 0x3F) + FIRMWARE_MATCH_MIN;
+				_fwTokenBytes = 2;
+			} else if (_fwEncoding & FIRMWARE_ENCODING_DELTA) {
+				_fwTokenBytes = 3;
+			} else {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+#endif
+
+static void transportRequestFirmwareBlock() {
+	if (!_fwUpdateOngoing || _flash.busy()) {
+		// Not before the flash is erased, blocks would have to wait for it in transportProcess()
+		return;
+	}
+	unsigned long enter = hwMillis();
+	if (_fwRequested && (enter - _fwLastRequestTime > MY_OTA_RETRY_DELAY)) {
+		if (!_fwRetry) {
+			debug(PSTR("fw upd fail\n"));
+			// Give up. We have requested MY_OTA_RETRY times without any packet in return.
+			transportFirmwareFailed();
+			return;
+		}
+		_fwRetry--;
+		// Whatever is still outstanding gets requested again, blocks already received are not
+		_fwRequested = 0;
+	}
+	// Request (at most) one block per call, answers to earlier requests may be waiting in the radio
+	uint16_t window = _fwBlocks - _fwBlock < MY_OTA_WINDOW_SIZE ? _fwBlocks - _fwBlock : MY_OTA_WINDOW_SIZE;
+	for (uint16_t block = _fwBlock; window--; block++) {
+		uint32_t bit = transportFirmwareBit(block);
+		if (!((_fwReceived | _fwRequested) & bit)) {
+			_fwRequested |= bit;
 			_fwLastRequestTime = enter;
 			// Time to (re-)request firmware block from controller
 			RequestFWBlock *firmwareRequest = (RequestFWBlock *)_msg.data;
 			mSetLength(_msg, sizeof(RequestFWBlock));
 			firmwareRequest->type = _fc.type;
 			firmwareRequest->version = _fc.version;
-			firmwareRequest->block = (_fwBlock - 1);
+			firmwareRequest->block = block;
 			_sendRoute(build(_msg, _nc.nodeId, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_STREAM, ST_FIRMWARE_REQUEST, false));
+			return;
+		}
+	}
+}
+#endif
+
+static void transportSetState(transport_state state) {
+	_transportState = state;
+	_transportStateTime = hwMillis();
+}
+
+// READY if parent and node id are known, else DISCONNECTED
+static transport_state transportIdleState() {
+	return _nc.parentNodeId != AUTO && _nc.nodeId != AUTO ? TRANSPORT_READY : TRANSPORT_DISCONNECTED;
+}
+
+transport_state transportGetState() {
+	if (_transportState == TRANSPORT_FIND_PARENT || _transportState == TRANSPORT_REQUEST_ID) {
+		return _transportState;
+	}
+	return transportIdleState();
+}
+
+// Take the best parent that answered the search
+static void transportFindParentDone() {
+	if (_searchParent != AUTO) {
+		if (_searchParent != _nc.parentNodeId || _searchDistance != _nc.distance) {
+			_nc.parentNodeId = _searchParent;
+			_nc.distance = _searchDistance;
+			hwWriteConfig(EEPROM_PARENT_NODE_ID_ADDRESS, _nc.parentNodeId);
+			hwWriteConfig(EEPROM_DISTANCE_ADDRESS, _nc.distance);
+		}
+		debug(PSTR("parent=%d, d=%d\n"), _nc.parentNodeId, _nc.distance);
+	} else {
+		// Nobody answered, the old parent (if any) is kept but we no longer know our distance
+		_nc.distance = DISTANCE_INVALID;
+	}
+}
+
+#if defined(MY_ASYNC_TRANSPORT_FEATURE)
+// Go on with whatever is still missing after a parent search or id response
+static void transportNextStep() {
+	if (_nc.parentNodeId == AUTO) {
+		// Retry after MY_TRANSPORT_RETRY_DELAY
+		transportSetState(TRANSPORT_DISCONNECTED);
+	} else if (_nc.nodeId == AUTO) {
+		transportRequestNodeId();
+	} else {
+		transportSetState(TRANSPORT_READY);
+		if (!_transportPresented) {
+			_transportPresented = true;
+			transportPresentNode();
+			if (presentation)
+				presentation();
+		}
+	}
+}
+
+void transportConnect() {
+	// Listen on our own address for the answers
+	transportSetAddress(_nc.nodeId);
+	if (_nc.parentNodeId == AUTO) {
+		transportFindParentNode();
+	} else {
+		transportNextStep();
+	}
+}
+
+void transportStateProcess() {
+	unsigned long elapsed = hwMillis() - _transportStateTime;
+	if (_transportState == TRANSPORT_FIND_PARENT && elapsed >= SEARCH_DURATION) {
+		transportFindParentDone();
+		transportNextStep();
+	} else if (_transportState == TRANSPORT_REQUEST_ID && elapsed >= REQUEST_DURATION) {
+		debug(PSTR("no id\n"));
+		transportSetState(TRANSPORT_DISCONNECTED);
+	} else if (_transportState == TRANSPORT_DISCONNECTED && elapsed >= MY_TRANSPORT_RETRY_DELAY) {
+		transportConnect();
+	}
+}
+#endif
+
+inline void transportProcess() {
+	uint8_t to = 0;
+	uint8_t length;
+	profileBegin(PROFILE_RADIO_READ);
+	#if defined(MY_RX_MESSAGE_BUFFER_FEATURE)
+		transportRxBufferFill();
+		if (transportRxBufferRead(&to, &length, _msg)) {
+			// Handle everything buffered, topping up from the radio between messages
+			do {
+				profileEnd(PROFILE_RADIO_READ);
+				profileBegin(PROFILE_MESSAGE);
+				transportProcessMessage(to, length);
+				profileEnd(PROFILE_MESSAGE);
+				profileBegin(PROFILE_RADIO_READ);
+				transportRxBufferFill();
+			} while (transportRxBufferRead(&to, &length, _msg));
+			return;
+		}
+	#else
+		if (transportAvailable(&to)) {
+			length = transportReceive((uint8_t *)&_msg);
+			profileEnd(PROFILE_RADIO_READ);
+			profileBegin(PROFILE_MESSAGE);
+			transportProcessMessage(to, length);
+			profileEnd(PROFILE_MESSAGE);
+			return;
+		}
+	#endif
+	#ifdef MY_OTA_FIRMWARE_FEATURE
+		transportRequestFirmwareBlock();
+	#endif
+}
+
+#if defined(MY_MESSAGE_SEQUENCE_FEATURE)
+// Returns true if this sender/sequence pair was seen recently, else remembers it
+static bool transportIsDuplicate(uint8_t sender, uint8_t sequence) {
+	unsigned long now = hwMillis();
+	SequenceWindowEntry *entry = NULL;
+	SequenceWindowEntry *oldest = &_sequenceWindow[0];
+	for (uint8_t i = 0; i < MY_SEQUENCE_WINDOW_SIZE; i++) {
+		SequenceWindowEntry *e = &_sequenceWindow[i];
+		if (e->count && e->sender == sender) {
+			entry = e;
+			break;
+		}
+		if (!e->count) {
+			oldest = e;
+		} else if (oldest->count && now - e->time > now - oldest->time) {
+			oldest = e;
+		}
+	}
+	if (entry && now - entry->time >= MY_SEQUENCE_WINDOW_TIME) {
+		// Nothing recent from this sender
+		entry->count = 0;
+	} else if (entry) {
+		for (uint8_t i = 0; i < entry->count; i++) {
+			if (entry->sequence[i] == sequence) {
+				return true;
+			}
+		}
+	} else {
+		// Take over the sender heard from least recently
+		entry = oldest;
+		entry->sender = sender;
+		entry->count = 0;
+	}
+	if (!entry->count) {
+		entry->next = 0;
+	}
+	entry->sequence[entry->next] = sequence;
+	entry->next = (entry->next + 1) % MY_SEQUENCE_WINDOW_DEPTH;
+	if (entry->count < MY_SEQUENCE_WINDOW_DEPTH) {
+		entry->count++;
+	}
+	entry->time = now;
+	return false;
+}
+#endif
+
+#if defined(MY_LINK_STATS_FEATURE)
+// Entry of a neighbor, takes over the least active entry if it is not in the table yet.
+// Not for AUTO: nodes without an id share it, and it marks unused entries.
+static LinkStats *transportLinkStats(uint8_t node) {
+	LinkStats *replace = _linkStats;
+	uint32_t replaceActivity = ~(uint32_t)0;
+	for (uint8_t i = 0; i < MY_LINK_STATS_SIZE; i++) {
+		LinkStats *stats = &_linkStats[i];
+		if (stats->nodeId == node) {
+			return stats;
+		}
+		uint32_t activity = stats->nodeId == AUTO ? 0 : (uint32_t)stats->txOk + stats->txFail + stats->rx;
+		if (activity < replaceActivity) {
+			replace = stats;
+			replaceActivity = activity;
 		}
-		#endif
-		return;
 	}
+	memset(replace, 0, sizeof(LinkStats));
+	replace->nodeId = node;
+	return replace;
+}
 
+void transportSendLinkStats() {
+	for (uint8_t i = 0; i < MY_LINK_STATS_SIZE; i++) {
+		if (_linkStats[i].nodeId != AUTO) {
+			// Copy first, sending updates the table
+			LinkStats stats = _linkStats[i];
+			_sendRoute(build(_msg, _nc.nodeId, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_LINK_STATS_RESPONSE, false).set(&stats, sizeof(LinkStats)));
+		}
+	}
+}
+
+#if defined(MY_LINK_STATS_REPORT_INTERVAL)
+void transportLinkStatsProcess() {
+	if (_nc.nodeId != AUTO && hwMillis() - _linkStatsReportTime >= MY_LINK_STATS_REPORT_INTERVAL) {
+		_linkStatsReportTime = hwMillis();
+		transportSendLinkStats();
+	}
+}
+#endif
+#endif
+
+// Message delivered through _msg, length is the size of the received frame
+void transportProcessMessage(uint8_t to, uint8_t length) {
 	(void)signerCheckTimer(); // Manage signing timeout
 
-	uint8_t payloadLength = transportReceive((uint8_t *)&_msg);
-	(void)payloadLength; //until somebody makes use of it
+	if (length < HEADER_SIZE) {
+		// Nothing usable, e.g. a frame the radio driver rejected
+		return;
+	}
+
 	ledBlinkRx(1);
 
 	
@@ -79,14 +615,25 @@ inline void transportProcess() {
 	uint8_t last = _msg.last;
 	uint8_t destination = _msg.destination;
 	
+	#if defined(MY_LINK_STATS_FEATURE)
+		if (last != AUTO) {
+			LinkStats *lastStats = transportLinkStats(last);
+			lastStats->rx++;
+			lastStats->rssi = transportGetRSSI();
+		}
+	#endif
 
 	// Reject massages that do not pass verification
-	if (!signerVerifyMsg(_msg)) {
+	profileBegin(PROFILE_VERIFY);
+	bool verified = signerVerifyMsg(_msg);
+	profileEnd(PROFILE_VERIFY);
+	if (!verified) {
 		debug(PSTR("verify fail\n"));
 		ledBlinkErr(1);
 		return;	
 	}
 
+	profileBegin(PROFILE_DEBUG);
 	if (destination == _nc.nodeId) {
 		debug(PSTR("read: %d-%d-%d s=%d,c=%d,t=%d,pt=%d,l=%d,sg=%d:%s\n"),
 					sender, _msg.last, destination, _msg.sensor, mGetCommand(_msg), type, mGetPayloadType(_msg), mGetLength(_msg), mGetSigned(_msg), _msg.getString(_convBuf));
@@ -101,6 +648,7 @@ inline void transportProcess() {
 					sender, _msg.last, destination, _msg.sensor, mGetCommand(_msg), type, mGetPayloadType(_msg), mGetLength(_msg),  mGetSigned(_msg), _msg.getString(_convBuf));
 	#endif
 	}
+	profileEnd(PROFILE_DEBUG);
 
 	if(!(mGetVersion(_msg) == PROTOCOL_VERSION)) {
 		debug(PSTR("ver mismatch\n"));
@@ -108,6 +656,17 @@ inline void transportProcess() {
 		return;
 	}
 
+	#if defined(MY_MESSAGE_SEQUENCE_FEATURE)
+		// Unsigned messages from nodes with this feature carry a sequence number after the payload
+		// (nodes without an id all send as AUTO, theirs are not told apart)
+		_msgSequenced = !mGetSigned(_msg) && length == HEADER_SIZE + mGetLength(_msg) + 1;
+		if (_msgSequenced && sender != AUTO && transportIsDuplicate(sender, _msg.data[mGetLength(_msg)])) {
+			// Same message again, the sender missed our hardware ack
+			debug(PSTR("dup\n"));
+			return;
+		}
+	#endif
+
 	if (destination == _nc.nodeId) {
 		// This message is addressed to this node
 		// prevent buffer overflow by limiting max. possible message length (5 bits=31 bytes max) to MAX_PAYLOAD (25 bytes)
@@ -118,7 +677,7 @@ inline void transportProcess() {
 		#if defined(MY_REPEATER_FEATURE)
 			if (_msg.last != _nc.parentNodeId) {
 				// Message is from one of the child nodes. Add it to routing table.
-				hwWriteConfig(EEPROM_ROUTES_ADDRESS+sender, _msg.last);
+				transportSetRoute(sender, _msg.last);
 			}
 		#endif
 
@@ -139,21 +698,18 @@ inline void transportProcess() {
 				return; // Signer processing indicated no further action needed
 			}
 			if (type == I_FIND_PARENT_RESPONSE) {
-				if (_autoFindParent) {
+				if (_autoFindParent && _transportState == TRANSPORT_FIND_PARENT) {
 					// We've received a reply to a FIND_PARENT message. Check if the distance is
-					// shorter than we already have.
+					// shorter than we already have. The parent is switched when the search ends.
 					uint8_t distance = _msg.getByte();
 					if (isValidDistance(distance))
 					{
 						// Distance to gateway is one more for us w.r.t. parent
 						distance++;
-						if (isValidDistance(distance) && (distance < _nc.distance)) {
+						if (isValidDistance(distance) && (distance < _searchDistance)) {
 							// Found a neighbor closer to GW than previously found
-							_nc.distance = distance;
-							_nc.parentNodeId = sender;
-							hwWriteConfig(EEPROM_PARENT_NODE_ID_ADDRESS, _nc.parentNodeId);
-							hwWriteConfig(EEPROM_DISTANCE_ADDRESS, _nc.distance);
-							debug(PSTR("parent=%d, d=%d\n"), _nc.parentNodeId, _nc.distance);
+							_searchDistance = distance;
+							_searchParent = sender;
 						}
 					}
 				}
@@ -168,12 +724,21 @@ inline void transportProcess() {
 						_infiniteLoop();
 						
 					}
-					transportPresentNode();
-					if (presentation)
-						presentation();
-					// Write id to EEPROM
-					hwWriteConfig(EEPROM_NODE_ID_ADDRESS, _nc.nodeId);
-					debug(PSTR("id=%d\n"), _nc.nodeId);
+					#if defined(MY_ASYNC_TRANSPORT_FEATURE)
+						// Write id to EEPROM
+						hwWriteConfig(EEPROM_NODE_ID_ADDRESS, _nc.nodeId);
+						debug(PSTR("id=%d\n"), _nc.nodeId);
+						// Presents the node if this was the last thing missing
+						transportNextStep();
+					#else
+						transportSetState(transportIdleState());
+						transportPresentNode();
+						if (presentation)
+							presentation();
+						// Write id to EEPROM
+						hwWriteConfig(EEPROM_NODE_ID_ADDRESS, _nc.nodeId);
+						debug(PSTR("id=%d\n"), _nc.nodeId);
+					#endif
 				} else {
 					_processInternalMessages();
 				}
@@ -183,10 +748,25 @@ inline void transportProcess() {
 		#ifdef MY_OTA_FIRMWARE_FEATURE
 		else if (command == C_STREAM) {
 			if (type == ST_FIRMWARE_CONFIG_RESPONSE) {
-				NodeFirmwareConfig *firmwareConfigResponse = (NodeFirmwareConfig *)_msg.data;
+				ReplyFirmwareConfig *firmwareConfigResponse = (ReplyFirmwareConfig *)_msg.data;
 				// compare with current node configuration, if they differ, start fw fetch process
 				if (memcmp(&_fc,firmwareConfigResponse,sizeof(NodeFirmwareConfig))) {
 					debug(PSTR("fw update\n"));
+					#if defined(MY_OTA_COMPRESSION_FEATURE)
+						_fwEncoding = mGetLength(_msg) >= sizeof(ReplyFirmwareConfig) ? firmwareConfigResponse->encoding : 0;
+						if ((_fwEncoding & ~_fwEncodings) ||
+							(_fwEncoding && (uint32_t)firmwareConfigResponse->streamBlocks * FIRMWARE_BLOCK_SIZE > FIRMWARE_STREAM_OFFSET)) {
+							debug(PSTR("fw encoding unsupported\n"));
+							return;
+						}
+						_fwBlocks = _fwEncoding ? firmwareConfigResponse->streamBlocks : firmwareConfigResponse->blocks;
+						_fwOutput = 0;
+						_fwOutputLength = 0;
+						_fwTokenBytes = 0;
+						_fwTokenLength = 0;
+					#else
+						_fwBlocks = firmwareConfigResponse->blocks;
+					#endif
 					// copy new FW config
 					memcpy(&_fc,firmwareConfigResponse,sizeof(NodeFirmwareConfig));
 					// Init flash
@@ -194,34 +774,71 @@ inline void transportProcess() {
 						debug(PSTR("flash init fail\n"));
 						_fwUpdateOngoing = false;
 					} else {
-						// erase lower 32K -> max flash size for ATMEGA328
+						// erase lower 32K -> max flash size for ATMEGA328. Blocks are requested once
+						// the erase has completed, meanwhile messages are processed as usual.
+						#if defined(MY_OTA_COMPRESSION_FEATURE)
+							if (_fwEncoding) {
+								// and the 32K above for the encoded image
+								_flash.blockErase64K(0);
+							} else
+						#endif
 						_flash.blockErase32K(0);
-						// wait until flash erased
-						while ( _flash.busy() );
-						_fwBlock = _fc.blocks;
+						_fwBlock = 0;
+						_fwCrc = ~0;
+						_fwReceived = 0;
+						_fwRequested = 0;
 						_fwUpdateOngoing = true;
 						// reset flags
 						_fwRetry = MY_OTA_RETRY+1;
-						_fwLastRequestTime = 0;
 					}
 					return ;
 				}
 				debug(PSTR("fw update skipped\n"));
 			} else if (type == ST_FIRMWARE_RESPONSE) {
 				if (_fwUpdateOngoing) {
-					// Save block to flash
-					debug(PSTR("fw block %d\n"), _fwBlock);
 					// extract FW block
 					ReplyFWBlock *firmwareResponse = (ReplyFWBlock *)_msg.data;
-					// write to flash
-					_flash.writeBytes( ((_fwBlock - 1) * FIRMWARE_BLOCK_SIZE) + FIRMWARE_START_OFFSET, firmwareResponse->data, FIRMWARE_BLOCK_SIZE);
-					// wait until flash written
-					while ( _flash.busy() );
-					_fwBlock--;
-					if (!_fwBlock) {
-						// We're finished! Do a checksum and reboot.
+					uint16_t block = firmwareResponse->block;
+					// Late duplicates of blocks already written or answers outside the window are dropped
+					if (block < _fwBlock || block - _fwBlock >= MY_OTA_WINDOW_SIZE || block >= _fwBlocks ||
+						(_fwReceived & transportFirmwareBit(block))) {
+						return;
+					}
+					// Save block to flash
+					debug(PSTR("fw block %d\n"), block);
+					// write to flash, the chip programs it while we go on
+					_flash.writeBytes(transportFirmwareBlockAddress(block), firmwareResponse->data, FIRMWARE_BLOCK_SIZE);
+					_fwReceived |= transportFirmwareBit(block);
+					_fwRequested &= ~transportFirmwareBit(block);
+					// Slide the window up over the blocks received in sequence. They are read back for
+					// the checksum, so it covers what ended up in flash without a pass over the image.
+					while (_fwBlock < _fwBlocks && (_fwReceived & 1)) {
+						uint8_t data[FIRMWARE_BLOCK_SIZE];
+						_flash.readBytes(transportFirmwareBlockAddress(_fwBlock), data, FIRMWARE_BLOCK_SIZE);
+						#if defined(MY_OTA_COMPRESSION_FEATURE)
+							if (_fwEncoding) {
+								if (!transportFirmwareDecode(data, FIRMWARE_BLOCK_SIZE)) {
+									debug(PSTR("fw decode fail\n"));
+									transportFirmwareFailed();
+									return;
+								}
+							} else
+						#endif
+						_fwCrc = transportFirmwareCrc(_fwCrc, data, FIRMWARE_BLOCK_SIZE);
+						_fwReceived >>= 1;
+						_fwRequested >>= 1;
+						_fwBlock++;
+					}
+					if (_fwBlock == _fwBlocks) {
+						// We're finished! Check the checksum and reboot.
 						_fwUpdateOngoing = false;
-						if (transportIsValidFirmware()) {
+						#if defined(MY_OTA_COMPRESSION_FEATURE)
+							transportFirmwareFlush();
+							if (_fwEncoding && _fwOutput != _fc.blocks * FIRMWARE_BLOCK_SIZE) {
+								_fwCrc = ~_fc.crc;
+							}
+						#endif
+						if (_fwCrc == _fc.crc) {
 							debug(PSTR("fw checksum ok\n"));
 							// All seems ok, write size and signature to flash (DualOptiboot will pick this up and flash it)
 							uint16_t fwsize = FIRMWARE_BLOCK_SIZE * _fc.blocks;
@@ -229,14 +846,19 @@ inline void transportProcess() {
 							_flash.writeBytes(0, OTAbuffer, 10);
 							// Write the new firmware config to eeprom
 							hwWriteConfigBlock((void*)&_fc, (void*)EEPROM_FIRMWARE_TYPE_ADDRESS, sizeof(NodeFirmwareConfig));
+							#if defined(MY_REPEATER_FEATURE)
+								transportSaveRoutes();
+							#endif
 							hwReboot();
 						} else {
 							debug(PSTR("fw checksum fail\n"));
+							transportFirmwareFailed();
+							return;
 						}
 					}
-					// reset flags
+					// reset flags, the timeout of blocks still outstanding starts over
 					_fwRetry = MY_OTA_RETRY+1;
-					_fwLastRequestTime = 0;
+					_fwLastRequestTime = hwMillis();
 				} else {
 					debug(PSTR("No fw update ongoing\n"));
 				}
@@ -247,11 +869,15 @@ inline void transportProcess() {
 		#endif
 		#if defined(MY_GATEWAY_FEATURE)
 			// Hand over message to controller
+			profileBegin(PROFILE_GATEWAY_SEND);
 			gatewayTransportSend(_msg);
+			profileEnd(PROFILE_GATEWAY_SEND);
 		#endif
 		// Call incoming message callback if available
 		if (receive) {
+			profileBegin(PROFILE_RECEIVE);
 			receive(_msg);
+			profileEnd(PROFILE_RECEIVE);
 		}
 		return;
 	} else if (destination == BROADCAST_ADDRESS) {
@@ -290,6 +916,11 @@ inline void transportProcess() {
 				}
 			} else if (to == _nc.nodeId) {
 				// We should try to relay this message to another node
+				#if defined(MY_LINK_STATS_FEATURE)
+					if (last != AUTO) {
+						transportLinkStats(last)->forwarded++;
+					}
+				#endif
 				_sendRoute(_msg);
 			}
 		}
@@ -301,14 +932,10 @@ inline void transportProcess() {
 bool transportIsValidFirmware() {
 	// init crc
 	uint16_t crc = ~0;
-	for (uint16_t i = 0; i < _fc.blocks * FIRMWARE_BLOCK_SIZE; ++i) {
-		crc ^= _flash.readByte(i + FIRMWARE_START_OFFSET);
-	    for (int8_t j = 0; j < 8; ++j) {
-	        if (crc & 1)
-	            crc = (crc >> 1) ^ 0xA001;
-	        else
-	            crc = (crc >> 1);
-	    }
+	uint8_t data[FIRMWARE_BLOCK_SIZE];
+	for (uint16_t block = 0; block < _fc.blocks; block++) {
+		_flash.readBytes(((uint32_t)block * FIRMWARE_BLOCK_SIZE) + FIRMWARE_START_OFFSET, data, FIRMWARE_BLOCK_SIZE);
+		crc = transportFirmwareCrc(crc, data, FIRMWARE_BLOCK_SIZE);
 	}
 	return crc == _fc.crc;
 }
@@ -323,8 +950,42 @@ boolean transportSendWrite(uint8_t to, MyMessage &message) {
 	message.last = _nc.nodeId;
 	ledBlinkTx(1);
 
+	#if defined(MY_MESSAGE_SEQUENCE_FEATURE)
+		// Append a sequence number if there is room. Messages from this node get a new one,
+		// relayed messages keep the one they came with. Nodes without an id send none.
+		bool sequenced = !mGetSigned(message) && length < MAX_PAYLOAD && message.sender != AUTO &&
+			(message.sender == _nc.nodeId || _msgSequenced);
+		uint8_t payloadEnd = 0;
+		if (sequenced) {
+			payloadEnd = message.data[length];
+			if (message.sender == _nc.nodeId) {
+				message.data[length] = ++_sequence;
+			}
+			length++;
+		}
+	#endif
+
 	bool ok = transportSend(to, &message, min(MAX_MESSAGE_LENGTH, HEADER_SIZE + length));
 
+	#if defined(MY_LINK_STATS_FEATURE)
+		if (to != BROADCAST_ADDRESS) {
+			LinkStats *stats = transportLinkStats(to);
+			if (ok) {
+				stats->txOk++;
+			} else {
+				stats->txFail++;
+			}
+			stats->txRetries += transportGetRetries();
+		}
+	#endif
+
+	#if defined(MY_MESSAGE_SEQUENCE_FEATURE)
+		if (sequenced) {
+			// Restore what was after the payload (string terminator)
+			message.data[length - 1] = payloadEnd;
+		}
+	#endif
+
 	debug(PSTR("send: %d-%d-%d-%d s=%d,c=%d,t=%d,pt=%d,l=%d,sg=%d,st=%s:%s\n"),
 			message.sender,message.last, to, message.destination, message.sensor, mGetCommand(message), message.type,
 			mGetPayloadType(message), mGetLength(message), mGetSigned(message), to==BROADCAST_ADDRESS ? "bc" : (ok ? "ok":"fail"), message.getString(_convBuf));
@@ -369,7 +1030,7 @@ boolean transportSendRoute(MyMessage &message) {
 		uint8_t dest = message.destination;
 		if (dest == GATEWAY_ADDRESS) {
 			// Store this address in routing table (if repeater)
-			hwWriteConfig(EEPROM_ROUTES_ADDRESS+sender, last);
+			transportSetRoute(sender, last);
 			// If destination is the gateway or if we aren't a repeater, let
 			// our parent take care of the message
 			ok = transportSendWrite(_nc.parentNodeId, message);
@@ -378,7 +1039,7 @@ boolean transportSendRoute(MyMessage &message) {
 			uint8_t route;
 			// INTERMEDIATE FIX: make sure corrupted routing table is not interfering with BC - observed several cases -tekka
 			if (dest!=BROADCAST_ADDRESS) {
-				route = hwReadConfig(EEPROM_ROUTES_ADDRESS+dest);
+				route = transportGetRoute(dest);
 			} else route = BROADCAST_ADDRESS;
 			if (route > GATEWAY_ADDRESS && route < BROADCAST_ADDRESS) {
 				// This message should be forwarded to a child node. If we send message
@@ -420,7 +1081,7 @@ boolean transportSendRoute(MyMessage &message) {
 				ok = transportSendWrite(_nc.parentNodeId, message);
 
 				// Add this child to our "routing table" if it not already exist
-				hwWriteConfig(EEPROM_ROUTES_ADDRESS+sender, last);
+				transportSetRoute(sender, last);
 
 			#endif
 		}
@@ -443,11 +1104,21 @@ boolean transportSendRoute(MyMessage &message) {
 
 
 void transportRequestNodeId() {
+	#if defined(MY_ASYNC_TRANSPORT_FEATURE)
+		if (_transportState == TRANSPORT_REQUEST_ID)
+			return;
+	#endif
 	debug(PSTR("req id\n"));
 	transportSetAddress(_nc.nodeId);
 	build(_msg, _nc.nodeId, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_ID_REQUEST, false).set("");
 	transportSendWrite(_nc.parentNodeId, _msg);
-	wait(2000, C_INTERNAL, I_ID_RESPONSE);
+	transportSetState(TRANSPORT_REQUEST_ID);
+	#if !defined(MY_ASYNC_TRANSPORT_FEATURE)
+		wait(REQUEST_DURATION, C_INTERNAL, I_ID_RESPONSE);
+		if (_transportState == TRANSPORT_REQUEST_ID) {
+			transportSetState(transportIdleState());
+		}
+	#endif
 }
 
 void transportPresentNode() {
@@ -477,36 +1148,28 @@ void transportPresentNode() {
 			// which is picked up in process()
 			_sendRoute(build(_msg, _nc.nodeId, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_CONFIG, false).set(_nc.parentNodeId));
 
-			// Wait configuration reply.
-			wait(2000, C_INTERNAL, I_CONFIG);
+			#if !defined(MY_ASYNC_TRANSPORT_FEATURE)
+				// Wait configuration reply.
+				wait(REQUEST_DURATION, C_INTERNAL, I_CONFIG);
+			#endif
 
 			#ifdef MY_OTA_FIRMWARE_FEATURE
-				RequestFirmwareConfig *reqFWConfig = (RequestFirmwareConfig *)_msg.data;
-				mSetLength(_msg, sizeof(RequestFirmwareConfig));
-				mSetCommand(_msg, C_STREAM);
-				mSetPayloadType(_msg,P_CUSTOM);
-				// copy node settings to reqFWConfig
-				memcpy(reqFWConfig,&_fc,sizeof(NodeFirmwareConfig));
-				// add bootloader information
-				reqFWConfig->BLVersion = MY_OTA_BOOTLOADER_VERSION;
-				_fwUpdateOngoing = false;
-				_sendRoute(build(_msg, _nc.nodeId, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_STREAM, ST_FIRMWARE_CONFIG_REQUEST, false));
+				transportRequestFirmwareConfig();
 			#endif
 		}
 	#endif
 }
 
 void transportFindParentNode() {
-	static boolean findingParentNode = false;
-
-	if (findingParentNode)
+	if (_transportState == TRANSPORT_FIND_PARENT)
 		return;
-	findingParentNode = true;
 
 	_failedTransmissions = 0;
 
-	// Set distance to max
-	_nc.distance = 255;
+	// Collect answers separately, the current parent keeps being used until the search ends
+	_searchParent = AUTO;
+	_searchDistance = DISTANCE_INVALID;
+	transportSetState(TRANSPORT_FIND_PARENT);
 
 	// Send ping message to BROADCAST_ADDRESS (to which all relaying nodes and gateway listens and should reply to)
 	debug(PSTR("find parent\n"));
@@ -515,7 +1178,10 @@ void transportFindParentNode() {
 	// Write msg, but suppress recursive parent search
 	transportSendWrite(BROADCAST_ADDRESS, _msg);
 
-	// Wait for ping response.
-	wait(2000);
-	findingParentNode = false;
+	#if !defined(MY_ASYNC_TRANSPORT_FEATURE)
+		// Wait for ping response.
+		wait(SEARCH_DURATION);
+		transportFindParentDone();
+		transportSetState(transportIdleState());
+	#endif
 }
@@ -33,6 +33,16 @@
 #define MY_OTA_RETRY_DELAY 500
 // Start offset for firmware in flash (DualOptiboot wants to keeps a signature first)
 #define FIRMWARE_START_OFFSET 10
+// Flash offset where the blocks of an encoded image are kept until decoded, above the 32K image
+#define FIRMWARE_STREAM_OFFSET 0x8000UL
+// Encodings of a firmware image, the node lists those it can decode in RequestFirmwareConfig
+#define FIRMWARE_ENCODING_LZ 0x01    // Back references to the image decoded so far
+#define FIRMWARE_ENCODING_DELTA 0x02 // References to the firmware the node is running
+// An encoded image is a sequence of these tokens
+#define FIRMWARE_TOKEN_LITERAL 0x00  // 0x00-0x7F: 1-128 bytes follow as they are
+#define FIRMWARE_TOKEN_MATCH 0x80    // 0x80-0xBF: copy 3-66 bytes from 1-65535 bytes back (16 bit big endian distance follows)
+#define FIRMWARE_TOKEN_BASE 0xC0     // 0xC0-0xFF: copy 1-16384 bytes of the running firmware (low length byte and 16 bit big endian address follow)
+#define FIRMWARE_MATCH_MIN 3
 // Bootloader version
 #define MY_OTA_BOOTLOADER_MAJOR_VERSION 3
 #define MY_OTA_BOOTLOADER_MINOR_VERSION 0
@@ -40,6 +50,18 @@
 
 // Search for a new parent node after this many transmission failures
 #define SEARCH_FAILURES  5
+// Milliseconds to collect I_FIND_PARENT_RESPONSE messages
+#define SEARCH_DURATION  2000
+// Milliseconds to wait for I_ID_RESPONSE (and I_CONFIG when presenting)
+#define REQUEST_DURATION 2000
+
+/// @brief State of the uplink, see transportGetState()
+typedef enum {
+	TRANSPORT_DISCONNECTED, //!< Parent or node id unknown
+	TRANSPORT_FIND_PARENT,  //!< Looking for a parent, an earlier one is still used meanwhile
+	TRANSPORT_REQUEST_ID,   //!< Waiting for a node id from the controller
+	TRANSPORT_READY         //!< Parent and node id known
+} transport_state;
 
 
 /// @brief FW config structure, stored in eeprom
@@ -57,8 +79,19 @@ typedef struct {
 	uint16_t blocks; //!< Number of blocks
 	uint16_t crc; //!< CRC of block data
 	uint16_t BLVersion; //!< Bootloader version
+	uint8_t encodings; //!< FIRMWARE_ENCODING_* flags the node can decode, only sent with MY_OTA_COMPRESSION_FEATURE
 } __attribute__((packed)) RequestFirmwareConfig;
 
+/// @brief FW config reply structure, older controllers send only the NodeFirmwareConfig part
+typedef struct {
+	uint16_t type; //!< Type of config
+	uint16_t version; //!< Version of config
+	uint16_t blocks; //!< Number of blocks of the decoded image
+	uint16_t crc; //!< CRC of the decoded image
+	uint8_t encoding; //!< FIRMWARE_ENCODING_* flags used by the image, 0 if sent as is
+	uint16_t streamBlocks; //!< Number of blocks of the encoded image
+} __attribute__((packed)) ReplyFirmwareConfig;
+
 /// @brief FW block request structure
 typedef struct {
 	uint16_t type; //!< Type of config
@@ -83,14 +116,83 @@ typedef struct {
 // invalid distance when searching for parent
 #define DISTANCE_INVALID (0xFF)
 
+#if defined(MY_RX_MESSAGE_BUFFER_FEATURE)
+/// @brief Raw frame as read from the radio
+typedef struct {
+	uint8_t to; //!< Address the frame was sent to
+	uint8_t length; //!< Number of valid bytes in data
+	uint8_t data[sizeof(MyMessage)]; //!< Frame (message header and payload)
+} RxFrame;
+
+/**
+ * Returns how many times the receive buffer was full while the radio still held frames.
+ */
+uint16_t transportRxBufferOverflows();
+#endif
+
+#if defined(MY_REPEATER_FEATURE)
+// Routing table: next hop towards each node (BROADCAST_ADDRESS if unknown)
+uint8_t transportGetRoute(uint8_t node);
+void transportSetRoute(uint8_t node, uint8_t route);
+void transportClearRoutes();
+/**
+ * Writes pending routing table changes to EEPROM (only needed with MY_RAM_ROUTING_TABLE_FEATURE).
+ */
+void transportSaveRoutes();
+#if defined(MY_RAM_ROUTING_TABLE_FEATURE)
+void transportLoadRoutes();
+void transportRoutesProcess();
+#endif
+#endif
+
+#if defined(MY_MESSAGE_SEQUENCE_FEATURE)
+/// @brief Recently received messages of one sender, for duplicate suppression
+typedef struct {
+	uint8_t sender; //!< Originating node
+	uint8_t count; //!< Sequence numbers held, 0 if the entry is unused
+	uint8_t next; //!< Sequence number to replace next
+	uint8_t sequence[MY_SEQUENCE_WINDOW_DEPTH]; //!< Sequence numbers given by the sender
+	unsigned long time; //!< When the last one was received
+} SequenceWindowEntry;
+#endif
+
+#if defined(MY_LINK_STATS_FEATURE)
+/// @brief Link statistics of one neighbor, payload of I_LINK_STATS_RESPONSE (little endian, counters wrap)
+typedef struct {
+	uint8_t nodeId; //!< Neighbor
+	uint16_t txOk; //!< Frames sent to it and acked
+	uint16_t txFail; //!< Frames sent to it without ack
+	uint16_t txRetries; //!< Radio retransmissions needed for those frames
+	uint16_t rx; //!< Frames received from it
+	uint16_t forwarded; //!< Messages from it relayed by this node
+	int8_t rssi; //!< Last received frame in dBm, 0 if the radio does not measure it
+} __attribute__((packed)) LinkStats;
+
+/**
+ * Sends an I_LINK_STATS_RESPONSE to the controller for every neighbor in the table.
+ */
+void transportSendLinkStats();
+#if defined(MY_LINK_STATS_REPORT_INTERVAL)
+void transportLinkStatsProcess();
+#endif
+#endif
+
 // Common functions in all radio drivers
 #ifdef MY_OTA_FIRMWARE_FEATURE
 	// do a crc16 on the whole received firmware
 	bool transportIsValidFirmware();
+	// ask the controller for the firmware this node should run
+	void transportRequestFirmwareConfig();
 #endif
 
 
 void transportProcess();
+transport_state transportGetState();
+#if defined(MY_ASYNC_TRANSPORT_FEATURE)
+void transportConnect(); // Start finding a parent/requesting an id as needed, presents the node once ready
+void transportStateProcess();
+#endif
+void transportProcessMessage(uint8_t to, uint8_t length);
 void transportRequestNodeId();
 void transportPresentNode();
 void transportFindParentNode();
@@ -105,5 +207,9 @@ bool transportSend(uint8_t to, const void* data, uint8_t len);
 bool transportAvailable(uint8_t *to);
 uint8_t transportReceive(void* data);
 void transportPowerDown();
+#if defined(MY_LINK_STATS_FEATURE)
+uint8_t transportGetRetries(); // Retransmissions needed by the last transportSend()
+int16_t transportGetRSSI(); // Signal strength of the last received frame in dBm, 0 if not available
+#endif
 
 #endif
@@ -31,6 +31,111 @@
 	uint8_t _psk[16];
 #endif
 
+#if defined(MY_RF24_ENABLE_ENCRYPTION) && defined(MY_RF24_ENCRYPTION_CCM)
+// A frame is the message encrypted in CTR mode (the first byte, the transmitting node, stays in
+// clear), then a 24 bit frame counter and the tag. The nonce is the transmitting node and the
+// counter, so no two frames of the network share one. The counter continues from EEPROM after a
+// reboot, skipping what was left of the block of RF24_COUNTER_BLOCK frames it was in. With erased
+// EEPROM it starts at a random block of the lower half, so a node that is cleared or replaced
+// under the same id is unlikely to repeat the frames it (or its predecessor) sent.
+// Nodes without an id all transmit as AUTO and cannot share a counter. They send their parent
+// and id requests in clear, receivers accept nothing else in clear.
+#define RF24_COUNTER_SIZE 3
+#define RF24_COUNTER_BLOCK 256
+#define RF24_COUNTER_BLOCKS_MAX 0xFFFF // The last block is never used, an erased EEPROM reads like it
+#define RF24_COUNTER_SEED_BLOCKS 0x8000 // Blocks an erased counter starts in
+#define RF24_COUNTER_WARN_BLOCKS 0x1000 // Warn on every block once fewer are left (a million frames)
+#define RF24_FRAME_OVERHEAD (RF24_COUNTER_SIZE + MY_RF24_ENCRYPTION_MAC_SIZE)
+
+#if MY_RF24_ENCRYPTION_MAC_SIZE != 0 && MY_RF24_ENCRYPTION_MAC_SIZE != 4 && \
+	MY_RF24_ENCRYPTION_MAC_SIZE != 6 && MY_RF24_ENCRYPTION_MAC_SIZE != 8
+	#error MY_RF24_ENCRYPTION_MAC_SIZE must be 0, 4, 6 or 8
+#endif
+#if MY_RF24_ENCRYPTION_REPLAY_SIZE < 1 || MY_RF24_ENCRYPTION_REPLAY_SIZE > 255
+	#error MY_RF24_ENCRYPTION_REPLAY_SIZE must be between 1 and 255
+#endif
+
+uint32_t _rf24Counter; // Next frame counter to send
+#if MY_RF24_ENCRYPTION_MAC_SIZE
+	/// @brief Last frame counter received from a neighbour
+	typedef struct {
+		uint8_t node; //!< Transmitting node, AUTO if the entry is unused
+		uint32_t counter; //!< Highest counter received from it
+	} RF24ReplayEntry;
+
+	RF24ReplayEntry _rf24Replay[MY_RF24_ENCRYPTION_REPLAY_SIZE];
+	uint8_t _rf24ReplayNext; // Entry to replace next
+#endif
+
+static void RF24_ccmNonce(uint8_t* nonce, uint8_t node, const uint8_t* counter) {
+	memset(nonce, 0, CCM_NONCE_BYTES);
+	nonce[0] = node;
+	memcpy(&nonce[1], counter, RF24_COUNTER_SIZE);
+}
+
+// Random counter block for a node with erased EEPROM. Noise of a floating pin and the boot time,
+// with the serial of the node, are mixed by the cipher.
+static uint16_t RF24_randomCounterBlock() {
+	uint8_t seed[N_BLOCK] = {0};
+	hwReadConfigBlock((void*)seed, (void*)EEPROM_SIGNING_SOFT_SERIAL_ADDRESS, 9);
+	uint32_t noise = hwMicros();
+	for (uint8_t i = 0; i < 32; i++) {
+		noise = (noise << 1 | noise >> 31) ^ analogRead(MY_RF24_ENCRYPTION_RANDOMSEED_PIN);
+	}
+	memcpy(&seed[9], &noise, sizeof(noise));
+	_aes.encrypt(seed, seed);
+	return (seed[0] | (uint16_t)seed[1] << 8) % RF24_COUNTER_SEED_BLOCKS;
+}
+
+// Whether a frame of a node without an id may be taken in clear (parent and id requests)
+static bool RF24_isClearRequest(const uint8_t* frame, uint8_t len) {
+	const MyMessage& msg = *(const MyMessage*)frame;
+	return len >= HEADER_SIZE && msg.sender == AUTO && mGetCommand(msg) == C_INTERNAL &&
+		(msg.type == I_FIND_PARENT || msg.type == I_ID_REQUEST);
+}
+
+#if MY_RF24_ENCRYPTION_MAC_SIZE
+// Rejects counters that are not newer than the last one seen from node, else remembers it.
+// Entries only live in RAM: a node that restarts its counter (EEPROM cleared, or replaced under
+// the same id) is dropped by neighbours that still hold its old counter until they reboot.
+// A node without an entry is accepted with any counter, so unless the table has one entry per
+// node id, recorded frames of a node whose entry was replaced pass again.
+static bool RF24_isReplay(uint8_t node, uint32_t counter) {
+	if (node == AUTO) {
+		// Nodes without an id share it, and AUTO marks unused entries
+		return false;
+	}
+	#if MY_RF24_ENCRYPTION_REPLAY_SIZE == 255
+		// One entry per node id, nothing is ever replaced
+		RF24ReplayEntry* entry = &_rf24Replay[node];
+		if (entry->node == node && counter <= entry->counter) {
+			return true;
+		}
+		entry->node = node;
+	#else
+		RF24ReplayEntry* entry = NULL;
+		for (uint8_t i = 0; i < MY_RF24_ENCRYPTION_REPLAY_SIZE; i++) {
+			if (_rf24Replay[i].node == node) {
+				entry = &_rf24Replay[i];
+				if (counter <= entry->counter) {
+					return true;
+				}
+				break;
+			}
+		}
+		if (!entry) {
+			// Not seen lately, nothing to compare with
+			entry = &_rf24Replay[_rf24ReplayNext];
+			_rf24ReplayNext = (_rf24ReplayNext + 1) % MY_RF24_ENCRYPTION_REPLAY_SIZE;
+			entry->node = node;
+		}
+	#endif
+	entry->counter = counter;
+	return false;
+}
+#endif
+#endif
+
 bool transportInit() {
 	
 	#if defined(MY_RF24_ENABLE_ENCRYPTION)
@@ -40,6 +145,22 @@ bool transportInit() {
 		// Make sure it is purged from memory when set
 		memset(_psk, 0, 16);
 	#endif
+	#if defined(MY_RF24_ENABLE_ENCRYPTION) && defined(MY_RF24_ENCRYPTION_CCM)
+		uint16_t block;
+		hwReadConfigBlock((void*)&block, (void*)EEPROM_RF24_COUNTER_ADDRESS, 2);
+		if (block == RF24_COUNTER_BLOCKS_MAX) {
+			// Erased, the block is written with the first frame
+			block = RF24_randomCounterBlock();
+		}
+		_rf24Counter = (uint32_t)block * RF24_COUNTER_BLOCK;
+		debug(PSTR("RF24: frame counter %lu of %lu\n"), (unsigned long)_rf24Counter,
+			(unsigned long)RF24_COUNTER_BLOCKS_MAX * RF24_COUNTER_BLOCK);
+		#if MY_RF24_ENCRYPTION_MAC_SIZE
+			for (uint8_t i = 0; i < MY_RF24_ENCRYPTION_REPLAY_SIZE; i++) {
+				_rf24Replay[i].node = AUTO;
+			}
+		#endif
+	#endif
 	
 	return RF24_initialize();
 }
@@ -54,7 +175,37 @@ uint8_t transportGetAddress() {
 }
 
 bool transportSend(uint8_t recipient, const void* data, uint8_t len) {
-	#if defined(MY_RF24_ENABLE_ENCRYPTION)
+	#if defined(MY_RF24_ENABLE_ENCRYPTION) && defined(MY_RF24_ENCRYPTION_CCM)
+		if (((const uint8_t*)data)[0] == AUTO) {
+			return RF24_sendMessage( recipient, data, len );
+		}
+		if (_rf24Counter % RF24_COUNTER_BLOCK == 0) {
+			// Entering a new block, a reboot continues after it
+			uint16_t next = _rf24Counter / RF24_COUNTER_BLOCK + 1;
+			if (next == RF24_COUNTER_BLOCKS_MAX) {
+				// Sending on would reuse nonces, only a new AES key (and cleared counter) helps
+				debug(PSTR("!RF24: frame counter used up, new AES key required\n"));
+				ledBlinkErr(1);
+				return false;
+			}
+			if (RF24_COUNTER_BLOCKS_MAX - next <= RF24_COUNTER_WARN_BLOCKS) {
+				debug(PSTR("!RF24: frame counter nearly used up, %lu frames left\n"),
+					(unsigned long)(RF24_COUNTER_BLOCKS_MAX - next) * RF24_COUNTER_BLOCK);
+				ledBlinkErr(1);
+			}
+			hwWriteConfigBlock((void*)&next, (void*)EEPROM_RF24_COUNTER_ADDRESS, 2);
+		}
+		uint8_t nonce[CCM_NONCE_BYTES];
+		uint8_t* counter = &_dataenc[len];
+		counter[0] = _rf24Counter >> 16;
+		counter[1] = _rf24Counter >> 8;
+		counter[2] = _rf24Counter;
+		_rf24Counter++;
+		memcpy(_dataenc, data, len);
+		RF24_ccmNonce(nonce, _dataenc[0], counter);
+		_aes.ccm_encrypt(nonce, NULL, 0, &_dataenc[1], len - 1, &counter[RF24_COUNTER_SIZE], MY_RF24_ENCRYPTION_MAC_SIZE);
+		bool status = RF24_sendMessage( recipient, _dataenc, len + RF24_FRAME_OVERHEAD );
+	#elif defined(MY_RF24_ENABLE_ENCRYPTION)
 		// copy input data because it is read-only
 		memcpy(_dataenc,data,len); 
 		// has to be adjusted, WIP!
@@ -76,8 +227,40 @@ bool transportAvailable(uint8_t *to) {
 }
 
 uint8_t transportReceive(void* data) {
-	uint8_t len = RF24_readMessage(data);
-	#if defined(MY_RF24_ENABLE_ENCRYPTION)
+	#if defined(MY_RF24_ENABLE_ENCRYPTION) && defined(MY_RF24_ENCRYPTION_CCM)
+		// Read into a full size buffer, the message is shorter than the frame
+		uint8_t len = RF24_readMessage(_dataenc);
+		if (_dataenc[0] == AUTO) {
+			if (!RF24_isClearRequest(_dataenc, len)) {
+				RF24_DEBUG(PSTR("clear frame dropped\n"));
+				return 0;
+			}
+			memcpy(data, _dataenc, len);
+			return len;
+		}
+		if (len <= RF24_FRAME_OVERHEAD + 1) {
+			return 0;
+		}
+		len -= RF24_FRAME_OVERHEAD;
+		uint8_t nonce[CCM_NONCE_BYTES];
+		uint8_t* counter = &_dataenc[len];
+		RF24_ccmNonce(nonce, _dataenc[0], counter);
+		if (_aes.ccm_decrypt(nonce, NULL, 0, &_dataenc[1], len - 1, &counter[RF24_COUNTER_SIZE],
+			MY_RF24_ENCRYPTION_MAC_SIZE) != AES_SUCCESS) {
+			RF24_DEBUG(PSTR("bad tag\n"));
+			return 0;
+		}
+		#if MY_RF24_ENCRYPTION_MAC_SIZE
+			if (RF24_isReplay(_dataenc[0], (uint32_t)counter[0] << 16 | (uint16_t)counter[1] << 8 | counter[2])) {
+				RF24_DEBUG(PSTR("replayed frame (or counter reset), node=%d\n"), _dataenc[0]);
+				return 0;
+			}
+		#endif
+		memcpy(data, _dataenc, len);
+	#else
+		uint8_t len = RF24_readMessage(data);
+	#endif
+	#if defined(MY_RF24_ENABLE_ENCRYPTION) && !defined(MY_RF24_ENCRYPTION_CCM)
 		// has to be adjusted, WIP!
 		_aes.set_IV(0);
 		// decrypt data
@@ -89,3 +272,14 @@ uint8_t transportReceive(void* data) {
 void transportPowerDown() {
 	RF24_powerDown();
 }
+
+#if defined(MY_LINK_STATS_FEATURE)
+uint8_t transportGetRetries() {
+	return (RF24_getObserveTX() >> ARC_CNT) & 0x0F;
+}
+
+int16_t transportGetRSSI() {
+	// The nRF24 only has a received power detector (RPD), no RSSI
+	return 0;
+}
+#endif
@@ -24,6 +24,9 @@
 
 RFM69 _radio(MY_RF69_SPI_CS, MY_RF69_IRQ_PIN, MY_RFM69HW, MY_RF69_IRQ_NUM);
 uint8_t _address;
+#if defined(MY_LINK_STATS_FEATURE)
+	uint8_t _retries; // Retries needed by the last transportSend()
+#endif
 
 
 bool transportInit() {
@@ -50,7 +53,21 @@ uint8_t transportGetAddress() {
 }
 
 bool transportSend(uint8_t to, const void* data, uint8_t len) {
-	return _radio.sendWithRetry(to,data,len);
+	#if defined(MY_LINK_STATS_FEATURE)
+		// Same as sendWithRetry() with its default 2 retries and 40ms wait, but counting retries
+		for (_retries = 0; ; _retries++) {
+			_radio.send(to, data, len, true);
+			unsigned long sentTime = hwMillis();
+			while (hwMillis() - sentTime < 40) {
+				if (_radio.ACKReceived(to))
+					return true;
+			}
+			if (_retries == 2)
+				return false;
+		}
+	#else
+		return _radio.sendWithRetry(to,data,len);
+	#endif
 }
 
 bool transportAvailable(uint8_t *to) {
@@ -73,3 +90,13 @@ uint8_t transportReceive(void* data) {
 void transportPowerDown() {
 	_radio.sleep();
 }
+
+#if defined(MY_LINK_STATS_FEATURE)
+uint8_t transportGetRetries() {
+	return _retries;
+}
+
+int16_t transportGetRSSI() {
+	return _radio.RSSI;
+}
+#endif
@@ -358,4 +358,15 @@ void transportPowerDown() {
 	// Nothing to shut down here
 }
 
+#if defined(MY_LINK_STATS_FEATURE)
+uint8_t transportGetRetries() {
+	// No retransmissions on the bus
+	return 0;
+}
+
+int16_t transportGetRSSI() {
+	return 0;
+}
+#endif
+
 
@@ -0,0 +1,74 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#include "MyConfig.h"
+#include "MyTransport.h"
+#include "drivers/RadioSim/RadioSim.h"
+
+const RadioSimHost* _simHost;
+uint8_t _address;
+
+RADIOSIM_EXPORT void simNodeAttach(const RadioSimHost* host) {
+	_simHost = host;
+}
+
+bool transportInit() {
+	return _simHost != NULL;
+}
+
+void transportSetAddress(uint8_t address) {
+	_address = address;
+	_simHost->setAddress(address);
+}
+
+uint8_t transportGetAddress() {
+	return _address;
+}
+
+bool transportSend(uint8_t to, const void* data, uint8_t len) {
+	return _simHost->send(to, data, len);
+}
+
+bool transportAvailable(uint8_t *to) {
+	if (_simHost->available(to)) {
+		return true;
+	}
+	// Nothing on air for us, let the other nodes run
+	_simHost->idle(0);
+	return false;
+}
+
+uint8_t transportReceive(void* data) {
+	return _simHost->receive(data);
+}
+
+void transportPowerDown() {
+	_simHost->powerDown();
+}
+
+#if defined(MY_LINK_STATS_FEATURE)
+uint8_t transportGetRetries() {
+	return _simHost->lastRetries();
+}
+
+int16_t transportGetRSSI() {
+	// No signal model, links only have a loss rate
+	return 0;
+}
+#endif
@@ -444,6 +444,107 @@ byte AES::cbc_decrypt (byte * cipher, byte * plain, int n_block)
   return AES_SUCCESS ;
 }
 
+/******************************************************************************/
+
+/* CCM* (RFC 3610 with L = 2, plus the unauthenticated mode of IEEE 802.15.4).
+   Block A_i (flags, nonce, counter i) encrypted gives the key stream S_i; S_0
+   encrypts the tag, S_1... the data. B_0 has the same layout with the tag size
+   in the flags and the data length as counter. */
+
+static void ccm_block (byte * block, byte flags, byte * nonce, unsigned int counter)
+{
+  block [0] = flags ;
+  memcpy (block + 1, nonce, CCM_NONCE_BYTES) ;
+  block [14] = counter >> 8 ;
+  block [15] = counter ;
+}
+
+byte AES::ccm_mac (byte * nonce, byte * aad, byte aad_length, byte * data, byte length, byte mac_size, byte * tag)
+{
+  byte x [N_BLOCK] ;
+  ccm_block (x, (aad_length ? 0x40 : 0) | ((mac_size - 2) / 2) << 3 | 1, nonce, length) ;
+  if (encrypt (x, x) != AES_SUCCESS)
+    return AES_FAILURE ;
+  if (aad_length)
+    {
+      // Two byte length, then the data, zero padded to a whole block
+      byte i = 2 ;
+      x [1] ^= aad_length ;
+      for (byte j = 0 ; j < aad_length ; j++)
+        {
+          x [i++] ^= aad [j] ;
+          if (i == N_BLOCK)
+            {
+              encrypt (x, x) ;
+              i = 0 ;
+            }
+        }
+      if (i)
+        encrypt (x, x) ;
+    }
+  for (byte j = 0 ; j < length ; j += N_BLOCK)
+    {
+      for (byte i = 0 ; i < N_BLOCK && j + i < length ; i++)
+        x [i] ^= data [j + i] ;
+      encrypt (x, x) ;
+    }
+  // Encrypt the tag with S_0
+  byte s [N_BLOCK] ;
+  ccm_block (s, 1, nonce, 0) ;
+  encrypt (s, s) ;
+  for (byte i = 0 ; i < mac_size ; i++)
+    tag [i] = x [i] ^ s [i] ;
+  return AES_SUCCESS ;
+}
+
+byte AES::ccm_ctr (byte * nonce, byte * data, byte length)
+{
+  byte s [N_BLOCK] ;
+  unsigned int counter = 1 ;
+  for (byte j = 0 ; j < length ; j += N_BLOCK)
+    {
+      ccm_block (s, 1, nonce, counter++) ;
+      if (encrypt (s, s) != AES_SUCCESS)
+        return AES_FAILURE ;
+      for (byte i = 0 ; i < N_BLOCK && j + i < length ; i++)
+        data [j + i] ^= s [i] ;
+    }
+  return AES_SUCCESS ;
+}
+
+/******************************************************************************/
+
+byte AES::ccm_encrypt (byte * nonce, byte * aad, byte aad_length, byte * data, byte length, byte * mac, byte mac_size)
+{
+  // The tag is taken over the plaintext
+  if (mac_size && ccm_mac (nonce, aad, aad_length, data, length, mac_size, mac) != AES_SUCCESS)
+    return AES_FAILURE ;
+  return ccm_ctr (nonce, data, length) ;
+}
+
+/******************************************************************************/
+
+byte AES::ccm_decrypt (byte * nonce, byte * aad, byte aad_length, byte * data, byte length, byte * mac, byte mac_size)
+{
+  if (ccm_ctr (nonce, data, length) != AES_SUCCESS)
+    return AES_FAILURE ;
+  if (mac_size)
+    {
+      byte tag [N_BLOCK] ;
+      byte diff = 0 ;
+      ccm_mac (nonce, aad, aad_length, data, length, mac_size, tag) ;
+      for (byte i = 0 ; i < mac_size ; i++)
+        diff |= tag [i] ^ mac [i] ;
+      if (diff)
+        {
+          // Do not hand out plaintext that failed authentication
+          memset (data, 0, length) ;
+          return AES_FAILURE ;
+        }
+    }
+  return AES_SUCCESS ;
+}
+
 /*****************************************************************************/
 
 void AES::set_IV(unsigned long long int IVCl){
@@ -150,6 +150,30 @@ class AES
 	 */
 	byte cbc_decrypt (byte * cipher, byte * plain, int n_block) ;
 		
+	/** CCM encrypt a message in place (CTR mode, no padding, with an optional CBC-MAC).
+	 *
+	 *  @param *nonce Pointer to the CCM_NONCE_BYTES byte nonce. It must never be used twice with the same key.
+	 *  @param *aad Pointer to data that is authenticated but not encrypted, may be NULL.
+	 *  @param aad_length Size of aad.
+	 *  @param *data Pointer to the plaintext, replaced by the ciphertext of the same size.
+	 *  @param length Size of the data, at most 255 bytes.
+	 *  @param *mac Pointer to where the tag is written.
+	 *  @param mac_size Size of the tag, 4 to 16 (even) or 0 for encryption only (CCM* of IEEE 802.15.4).
+	 *  @return 0 if SUCCESS or -1 if FAILURE
+	 */
+	byte ccm_encrypt (byte * nonce, byte * aad, byte aad_length, byte * data, byte length, byte * mac, byte mac_size) ;
+	/** CCM decrypt a message in place and check its tag.
+	 *
+	 *  @param *nonce Pointer to the nonce the message was encrypted with.
+	 *  @param *aad Pointer to the authenticated data, may be NULL.
+	 *  @param aad_length Size of aad.
+	 *  @param *data Pointer to the ciphertext, replaced by the plaintext (zeroed if the tag does not match).
+	 *  @param length Size of the data.
+	 *  @param *mac Pointer to the received tag.
+	 *  @param mac_size Size of the tag, 0 if there is none.
+	 *  @return 0 if SUCCESS or -1 if FAILURE (also if the tag does not match)
+	 */
+	byte ccm_decrypt (byte * nonce, byte * aad, byte aad_length, byte * data, byte length, byte * mac, byte mac_size) ;
 	/** Sets IV (initialization vector) and IVC (IV counter).
 	 *  This function changes the ivc and iv variables needed for AES.
 	 *
@@ -294,6 +318,8 @@ class AES
 		double millis();
 	#endif
  private:
+  byte ccm_mac (byte * nonce, byte * aad, byte aad_length, byte * data, byte length, byte mac_size, byte * tag) ;
+  byte ccm_ctr (byte * nonce, byte * data, byte length) ;
   int round ;/**< holds the number of rounds to be used. */
   byte key_sched [KEY_SCHEDULE_BYTES] ;/**< holds the pre-computed key for the encryption/decrpytion. */
   unsigned long long int IVC;/**< holds the initialization vector counter in numerical format. */
@@ -358,6 +384,7 @@ class AES
  * @li Able to effectively encrypt and decrypt any size of string.
  * @li Able to encrypt and decrypt using AES
  * @li Able to encrypt and decrypt using AES-CBC
+ * @li Able to encrypt and authenticate using AES-CCM
  * @li Easy for the user to use in his programs.
  *
  * @section Acknowledgements Acknowledgements
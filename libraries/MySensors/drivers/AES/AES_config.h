@@ -42,6 +42,7 @@
 #define N_BLOCK   (N_ROW * N_COL)
 #define N_MAX_ROUNDS           14
 #define KEY_SCHEDULE_BYTES ((N_MAX_ROUNDS + 1) * N_BLOCK)
+#define CCM_NONCE_BYTES   13  // CCM with a two byte length field
 #define AES_SUCCESS (0)
 #define AES_FAILURE (-1)
 
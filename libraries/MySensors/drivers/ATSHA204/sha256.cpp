@@ -38,13 +38,25 @@ void Sha256Class::init(void) {
   bufferOffset = 0;
 }
 
-uint32_t Sha256Class::ror32(uint32_t number, uint8_t bits) {
-  return ((number << (32-bits)) | (number >> bits));
-}
+#define ROTR(x,n) (((x) >> (n)) | ((x) << (32-(n))))
+#define SIGMA0(x) (ROTR(x,2) ^ ROTR(x,13) ^ ROTR(x,22))
+#define SIGMA1(x) (ROTR(x,6) ^ ROTR(x,11) ^ ROTR(x,25))
+#define GAMMA0(x) (ROTR(x,7) ^ ROTR(x,18) ^ ((x) >> 3))
+#define GAMMA1(x) (ROTR(x,17) ^ ROTR(x,19) ^ ((x) >> 10))
+#define CH(e,f,g) ((g) ^ ((e) & ((f) ^ (g))))
+#define MAJ(a,b,c) (((a) & (b)) | ((c) & ((a) | (b))))
+// Message schedule for rounds 16-63, kept in a ring of 16 words
+#define SCHEDULE(i) (w[(i)&15] += GAMMA1(w[((i)-2)&15]) + w[((i)-7)&15] + GAMMA0(w[((i)-15)&15]))
+// One round, the caller rotates the variable names instead of moving the values
+#define ROUND(a,b,c,d,e,f,g,h,i,wi) \
+  t1 = h + SIGMA1(e) + CH(e,f,g) + pgm_read_dword(sha256K+(i)) + (wi); \
+  d += t1; \
+  h = t1 + SIGMA0(a) + MAJ(a,b,c);
 
 void Sha256Class::hashBlock() {
   uint8_t i;
-  uint32_t a,b,c,d,e,f,g,h,t1,t2;
+  uint32_t a,b,c,d,e,f,g,h,t1;
+  uint32_t* w = buffer.w;
 
   a=state.w[0];
   b=state.w[1];
@@ -54,24 +66,26 @@ void Sha256Class::hashBlock() {
   f=state.w[5];
   g=state.w[6];
   h=state.w[7];
-  
-  for (i=0; i<64; i++) {
-    if (i>=16) {
-      t1 = buffer.w[i&15] + buffer.w[(i-7)&15];
-      t2 = buffer.w[(i-2)&15];
-      t1 += ror32(t2,17) ^ ror32(t2,19) ^ (t2>>10);
-      t2 = buffer.w[(i-15)&15];
-      t1 += ror32(t2,7) ^ ror32(t2,18) ^ (t2>>3);
-      buffer.w[i&15] = t1;
-    }
-    t1 = h;
-    t1 += ror32(e,6) ^ ror32(e,11) ^ ror32(e,25); // ∑1(e)
-    t1 += g ^ (e & (g ^ f)); // Ch(e,f,g)
-    t1 += pgm_read_dword(sha256K+i); // Ki
-    t1 += buffer.w[i&15]; // Wi
-    t2 = ror32(a,2) ^ ror32(a,13) ^ ror32(a,22); // ∑0(a)
-    t2 += ((b & c) | (a & (b | c))); // Maj(a,b,c)
-    h=g; g=f; f=e; e=d+t1; d=c; c=b; b=a; a=t1+t2;
+
+  for (i=0; i<16; i+=8) {
+    ROUND(a,b,c,d,e,f,g,h,i+0,w[i+0]);
+    ROUND(h,a,b,c,d,e,f,g,i+1,w[i+1]);
+    ROUND(g,h,a,b,c,d,e,f,i+2,w[i+2]);
+    ROUND(f,g,h,a,b,c,d,e,i+3,w[i+3]);
+    ROUND(e,f,g,h,a,b,c,d,i+4,w[i+4]);
+    ROUND(d,e,f,g,h,a,b,c,i+5,w[i+5]);
+    ROUND(c,d,e,f,g,h,a,b,i+6,w[i+6]);
+    ROUND(b,c,d,e,f,g,h,a,i+7,w[i+7]);
+  }
+  for (; i<64; i+=8) {
+    ROUND(a,b,c,d,e,f,g,h,i+0,SCHEDULE(i+0));
+    ROUND(h,a,b,c,d,e,f,g,i+1,SCHEDULE(i+1));
+    ROUND(g,h,a,b,c,d,e,f,i+2,SCHEDULE(i+2));
+    ROUND(f,g,h,a,b,c,d,e,i+3,SCHEDULE(i+3));
+    ROUND(e,f,g,h,a,b,c,d,i+4,SCHEDULE(i+4));
+    ROUND(d,e,f,g,h,a,b,c,i+5,SCHEDULE(i+5));
+    ROUND(c,d,e,f,g,h,a,b,i+6,SCHEDULE(i+6));
+    ROUND(b,c,d,e,f,g,h,a,i+7,SCHEDULE(i+7));
   }
   state.w[0] += a;
   state.w[1] += b;
@@ -97,6 +111,27 @@ void Sha256Class::write(uint8_t data) {
   addUncounted(data);
 }
 
+void Sha256Class::write(const uint8_t* data, size_t length) {
+  byteCount += length;
+  // Top up a partly filled block
+  while (length && bufferOffset) {
+    addUncounted(*data++);
+    length--;
+  }
+  // Hash whole blocks straight from the input
+  while (length >= BLOCK_LENGTH) {
+    for (uint8_t i=0; i<BLOCK_LENGTH/4; i++, data+=4) {
+      buffer.w[i] = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+    }
+    hashBlock();
+    length -= BLOCK_LENGTH;
+  }
+  // Keep the rest for the next write
+  while (length--) {
+    buffer.b[bufferOffset++ ^ 3] = *data++;
+  }
+}
+
 void Sha256Class::pad() {
   // Implement SHA-256 padding (fips180-2 §5.1.1)
 
@@ -138,35 +173,55 @@ uint8_t* Sha256Class::result(void) {
 #define HMAC_IPAD 0x36
 #define HMAC_OPAD 0x5c
 
-uint8_t keyBuffer[BLOCK_LENGTH]; // K0 in FIPS-198a
-uint8_t innerHash[HASH_LENGTH];
-
-void Sha256Class::initHmac(const uint8_t* key, int keyLength) {
+void Sha256Class::setHmacKey(const uint8_t* key, int keyLength) {
   uint8_t i;
+  uint8_t keyBuffer[BLOCK_LENGTH]; // K0 in FIPS-198a
   memset(keyBuffer,0,BLOCK_LENGTH);
   if (keyLength > BLOCK_LENGTH) {
     // Hash long keys
     init();
-    for (;keyLength--;) write(*key++);
+    write(key, keyLength);
     memcpy(keyBuffer,result(),HASH_LENGTH);
   } else {
     // Block length keys are used as is
     memcpy(keyBuffer,key,keyLength);
   }
-  // Start inner hash
+  // The padded key is the first block of both hashes, keep the states after it
+  uint8_t pad[BLOCK_LENGTH];
+  for (i=0; i<BLOCK_LENGTH; i++) {
+    pad[i] = keyBuffer[i] ^ HMAC_IPAD;
+  }
   init();
+  write(pad, BLOCK_LENGTH);
+  memcpy(innerState,state.w,HASH_LENGTH);
   for (i=0; i<BLOCK_LENGTH; i++) {
-    write(keyBuffer[i] ^ HMAC_IPAD);
+    pad[i] = keyBuffer[i] ^ HMAC_OPAD;
   }
+  init();
+  write(pad, BLOCK_LENGTH);
+  memcpy(outerState,state.w,HASH_LENGTH);
+  memset(keyBuffer,0,BLOCK_LENGTH);
+}
+
+void Sha256Class::initHmac(void) {
+  // Start inner hash after the padded key
+  memcpy(state.w,innerState,HASH_LENGTH);
+  byteCount = BLOCK_LENGTH;
+  bufferOffset = 0;
+}
+
+void Sha256Class::initHmac(const uint8_t* key, int keyLength) {
+  setHmacKey(key, keyLength);
+  initHmac();
 }
 
 uint8_t* Sha256Class::resultHmac(void) {
-  uint8_t i;
   // Complete inner hash
   memcpy(innerHash,result(),HASH_LENGTH);
   // Calculate outer hash
-  init();
-  for (i=0; i<BLOCK_LENGTH; i++) write(keyBuffer[i] ^ HMAC_OPAD);
-  for (i=0; i<HASH_LENGTH; i++) write(innerHash[i]);
+  memcpy(state.w,outerState,HASH_LENGTH);
+  byteCount = BLOCK_LENGTH;
+  bufferOffset = 0;
+  write(innerHash, HASH_LENGTH);
   return result();
 }
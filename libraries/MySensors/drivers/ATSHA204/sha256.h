@@ -3,6 +3,7 @@
 #define Sha256_h
 #if !DOXYGEN
 #include <inttypes.h>
+#include <stddef.h>
 
 #define HASH_LENGTH 32
 #define BLOCK_LENGTH 64
@@ -21,19 +22,22 @@ class Sha256Class
   public:
     void init(void);
     void initHmac(const uint8_t* secret, int secretLength);
+    void setHmacKey(const uint8_t* secret, int secretLength); // Hashes the padded key once
+    void initHmac(void); // Starts an HMAC with the key of the last setHmacKey()
     uint8_t* result(void);
     uint8_t* resultHmac(void);
     void write(uint8_t);
+    void write(const uint8_t* data, size_t length); // Hashes whole 64 byte blocks without buffering
   private:
     void pad();
     void addUncounted(uint8_t data);
     void hashBlock();
-    uint32_t ror32(uint32_t number, uint8_t bits);
     _buffer buffer;
     uint8_t bufferOffset;
     _state state;
     uint32_t byteCount;
-    uint8_t keyBuffer[BLOCK_LENGTH];
+    uint32_t innerState[HASH_LENGTH/4]; // State after the ipad block
+    uint32_t outerState[HASH_LENGTH/4]; // State after the opad block
     uint8_t innerHash[HASH_LENGTH];
 };
 
@@ -0,0 +1,144 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#include "Arduino.h"
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#if defined(MY_RADIO_SIM)
+	#include "drivers/RadioSim/RadioSim.h"
+#endif
+
+static uint64_t arduinoMonotonicMicros(void) {
+#if defined(MY_RADIO_SIM)
+	// Every time query is a point where the simulator may run other nodes
+	_simHost->idle(0);
+	return _simHost->micros();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000UL + ts.tv_nsec / 1000;
+#endif
+}
+
+#if defined(MY_RADIO_SIM)
+	// The virtual clock already starts at zero
+	static const uint64_t _arduinoStartMicros = 0;
+#else
+	static const uint64_t _arduinoStartMicros = arduinoMonotonicMicros();
+#endif
+
+unsigned long millis(void) {
+	return (unsigned long)((arduinoMonotonicMicros() - _arduinoStartMicros) / 1000);
+}
+
+unsigned long micros(void) {
+	return (unsigned long)(arduinoMonotonicMicros() - _arduinoStartMicros);
+}
+
+void delay(unsigned long ms) {
+#if defined(MY_RADIO_SIM)
+	_simHost->idle(ms * 1000);
+#else
+	usleep(ms * 1000);
+#endif
+}
+
+void delayMicroseconds(unsigned int us) {
+#if defined(MY_RADIO_SIM)
+	_simHost->idle(us);
+#else
+	usleep(us);
+#endif
+}
+
+void yield(void) {
+#if defined(MY_RADIO_SIM)
+	_simHost->idle(0);
+#else
+	sched_yield();
+#endif
+}
+
+long random(long howbig) {
+	if (howbig == 0) {
+		return 0;
+	}
+	return random() % howbig;
+}
+
+long random(long howsmall, long howbig) {
+	if (howsmall >= howbig) {
+		return howsmall;
+	}
+	return random(howbig - howsmall) + howsmall;
+}
+
+void randomSeed(unsigned long seed) {
+	if (seed != 0) {
+		srandom(seed);
+	}
+}
+
+int analogRead(uint8_t pin) {
+	// Floating pins are typically read for entropy, give them some
+	(void)pin;
+	return (int)(arduinoMonotonicMicros() & 0x3FF);
+}
+
+char *ultoa(unsigned long value, char *str, int radix) {
+	char tmp[sizeof(unsigned long) * 8 + 1];
+	char *p = tmp;
+	do {
+		uint8_t digit = value % radix;
+		*p++ = digit < 10 ? '0' + digit : 'a' + digit - 10;
+		value /= radix;
+	} while (value);
+	char *dst = str;
+	while (p != tmp) {
+		*dst++ = *--p;
+	}
+	*dst = '\0';
+	return str;
+}
+
+char *ltoa(long value, char *str, int radix) {
+	if (value < 0 && radix == 10) {
+		str[0] = '-';
+		ultoa(-(unsigned long)value, str + 1, radix);
+		return str;
+	}
+	return ultoa((unsigned long)value, str, radix);
+}
+
+char *utoa(unsigned int value, char *str, int radix) {
+	return ultoa(value, str, radix);
+}
+
+char *itoa(int value, char *str, int radix) {
+	if (value < 0 && radix == 10) {
+		return ltoa(value, str, radix);
+	}
+	return ultoa((unsigned int)value, str, radix);
+}
+
+char *dtostrf(double value, signed char width, unsigned char prec, char *str) {
+	sprintf(str, "%*.*f", width, prec, value);
+	return str;
+}
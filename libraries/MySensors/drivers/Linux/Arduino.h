@@ -0,0 +1,96 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ *******************************
+ *
+ * Minimal Arduino API needed to build the MySensors core as a Linux host process.
+ * Add this directory to the include path (-I drivers/Linux) so that <Arduino.h>
+ * resolves here. Only what the core library actually uses is provided.
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+
+#include "LinuxSerial.h"
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define max(a,b) ((a)>(b)?(a):(b))
+
+// Program memory is ordinary memory on the host
+#define PROGMEM
+#define PSTR(x) (x)
+class __FlashStringHelper;
+#define F(x) (reinterpret_cast<const __FlashStringHelper *>(x))
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define strncpy_P strncpy
+#define snprintf_P snprintf
+#define vsnprintf_P vsnprintf
+
+// Timing (monotonic clock, starts at zero when the process starts)
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield(void);
+
+// Pseudo random numbers
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+// There is no GPIO on a generic host; keep the calls harmless
+static inline void pinMode(uint8_t pin, uint8_t mode) { (void)pin; (void)mode; }
+static inline void digitalWrite(uint8_t pin, uint8_t value) { (void)pin; (void)value; }
+static inline int digitalRead(uint8_t pin) { (void)pin; return HIGH; }
+int analogRead(uint8_t pin);
+static inline void noInterrupts(void) {}
+static inline void interrupts(void) {}
+
+// Number formatting helpers from avr-libc
+char *itoa(int value, char *str, int radix);
+char *utoa(unsigned int value, char *str, int radix);
+char *ltoa(long value, char *str, int radix);
+char *ultoa(unsigned long value, char *str, int radix);
+char *dtostrf(double value, signed char width, unsigned char prec, char *str);
+
+#endif
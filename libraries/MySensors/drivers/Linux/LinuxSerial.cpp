@@ -0,0 +1,195 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#include "LinuxSerial.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <termios.h>
+
+// How long write() waits for a reader to make room before output is dropped. Once it
+// timed out, output is dropped without waiting until a write goes through again.
+#define LINUX_SERIAL_WRITE_TIMEOUT_MS 100
+
+LinuxSerial Serial;
+
+LinuxSerial::LinuxSerial() : _in(-1), _out(-1), _ptyLink(NULL), _rxHead(0), _rxTail(0), _dropping(false) {
+}
+
+// Waits up to timeout ms for fd to be ready for events
+static bool serialPoll(int fd, short events, int timeout) {
+	struct pollfd pfd;
+	pfd.fd = fd;
+	pfd.events = events;
+	int ret;
+	do {
+		ret = poll(&pfd, 1, timeout);
+	} while (ret < 0 && errno == EINTR);
+	return ret > 0;
+}
+
+void LinuxSerial::setPty(const char *link) {
+	_ptyLink = link;
+	// Remember that a pty was requested even without a symlink
+	if (_ptyLink == NULL) {
+		_ptyLink = "";
+	}
+}
+
+void LinuxSerial::begin(unsigned long baud) {
+	(void)baud;
+	if (_out >= 0) {
+		return;
+	}
+	if (_ptyLink == NULL) {
+		_in = STDIN_FILENO;
+		_out = STDOUT_FILENO;
+	} else {
+		int fd = posix_openpt(O_RDWR | O_NOCTTY);
+		if (fd < 0 || grantpt(fd) || unlockpt(fd)) {
+			fprintf(stderr, "Could not create pty: %s\n", strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		// Raw mode, the gateway protocol does its own line handling
+		struct termios tio;
+		if (!tcgetattr(fd, &tio)) {
+			cfmakeraw(&tio);
+			tcsetattr(fd, TCSANOW, &tio);
+		}
+		const char *slave = ptsname(fd);
+		if (_ptyLink[0]) {
+			unlink(_ptyLink);
+			if (symlink(slave, _ptyLink)) {
+				fprintf(stderr, "Could not link %s to %s: %s\n", _ptyLink, slave, strerror(errno));
+			}
+		}
+		fprintf(stderr, "Serial device: %s\n", slave);
+		// The pty is ours alone (stdin/stdout may be shared with the shell, they are only polled)
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+		_in = fd;
+		_out = fd;
+	}
+}
+
+bool LinuxSerial::fill(void) {
+	if (_rxHead != _rxTail) {
+		return true;
+	}
+	if (_in < 0 || !serialPoll(_in, POLLIN, 0)) {
+		return false;
+	}
+	ssize_t n = ::read(_in, _rxBuffer, sizeof(_rxBuffer));
+	if (n <= 0) {
+		return false;
+	}
+	_rxHead = 0;
+	_rxTail = (uint16_t)n;
+	return true;
+}
+
+int LinuxSerial::available(void) {
+	return fill() ? _rxTail - _rxHead : 0;
+}
+
+int LinuxSerial::read(void) {
+	if (!fill()) {
+		return -1;
+	}
+	return _rxBuffer[_rxHead++];
+}
+
+size_t LinuxSerial::write(const uint8_t *buf, size_t len) {
+	if (_out < 0) {
+		return 0;
+	}
+	size_t done = 0;
+	while (done < len) {
+		if (!serialPoll(_out, POLLOUT, _dropping ? 0 : LINUX_SERIAL_WRITE_TIMEOUT_MS)) {
+			// Nobody reads, drop the rest
+			_dropping = true;
+			break;
+		}
+		ssize_t n = ::write(_out, buf + done, len - done);
+		if (n < 0) {
+			if (errno == EAGAIN || errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		_dropping = false;
+		done += n;
+	}
+	return done;
+}
+
+size_t LinuxSerial::write(uint8_t c) {
+	return write(&c, 1);
+}
+
+size_t LinuxSerial::print(const char *str) {
+	return write((const uint8_t *)str, strlen(str));
+}
+
+size_t LinuxSerial::print(const __FlashStringHelper *str) {
+	return print((const char *)str);
+}
+
+size_t LinuxSerial::print(char c) {
+	return write((uint8_t)c);
+}
+
+size_t LinuxSerial::print(long n) {
+	char buf[24];
+	snprintf(buf, sizeof(buf), "%ld", n);
+	return print(buf);
+}
+
+size_t LinuxSerial::print(unsigned long n) {
+	char buf[24];
+	snprintf(buf, sizeof(buf), "%lu", n);
+	return print(buf);
+}
+
+size_t LinuxSerial::println(void) {
+	return print("\r\n");
+}
+
+size_t LinuxSerial::println(const char *str) {
+	return print(str) + println();
+}
+
+size_t LinuxSerial::println(const __FlashStringHelper *str) {
+	return print(str) + println();
+}
+
+size_t LinuxSerial::println(long n) {
+	return print(n) + println();
+}
+
+size_t LinuxSerial::println(unsigned long n) {
+	return print(n) + println();
+}
+
+void LinuxSerial::flush(void) {
+	// Writes are unbuffered
+}
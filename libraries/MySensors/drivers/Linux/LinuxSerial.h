@@ -0,0 +1,79 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ *******************************
+ *
+ * Serial device for Linux hosts. Talks either to stdin/stdout or to a
+ * pseudo terminal that a controller can open like a USB serial gateway.
+ */
+
+#ifndef LinuxSerial_h
+#define LinuxSerial_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+class __FlashStringHelper;
+
+class LinuxSerial
+{
+  public:
+    LinuxSerial();
+    /**
+     * Use stdin/stdout, or the pty selected with setPty(). Baud rate is ignored.
+     */
+    void begin(unsigned long baud);
+    /**
+     * Create a pseudo terminal on begin() instead of using stdin/stdout.
+     * @param link If not NULL, a symlink to the slave side is created at this path.
+     */
+    void setPty(const char *link);
+    int available(void);
+    int read(void);
+    size_t write(uint8_t c);
+    size_t write(const uint8_t *buf, size_t len);
+    size_t print(const char *str);
+    size_t print(const __FlashStringHelper *str);
+    size_t print(char c);
+    size_t print(long n);
+    size_t print(unsigned long n);
+    size_t print(int n) { return print((long)n); }
+    size_t print(unsigned int n) { return print((unsigned long)n); }
+    size_t println(void);
+    size_t println(const char *str);
+    size_t println(const __FlashStringHelper *str);
+    size_t println(long n);
+    size_t println(unsigned long n);
+    size_t println(int n) { return println((long)n); }
+    size_t println(unsigned int n) { return println((unsigned long)n); }
+    void flush(void);
+    operator bool() { return _out >= 0; }
+  private:
+    bool fill(void);
+    int _in;
+    int _out;
+    const char *_ptyLink;
+    uint8_t _rxBuffer[256];
+    uint16_t _rxHead;
+    uint16_t _rxTail;
+    bool _dropping; // Last write timed out
+};
+
+extern LinuxSerial Serial;
+
+#endif
@@ -153,6 +153,11 @@ LOCAL bool RF24_sendMessage( uint8_t recipient, const void* buf, uint8_t len ) {
 	return (status & _BV(TX_DS));
 }
 
+LOCAL uint8_t RF24_getObserveTX(void) {
+	// lost packets (PLOS_CNT) and retransmissions of the last packet (ARC_CNT)
+	return RF24_readByteRegister(OBSERVE_TX);
+}
+
 LOCAL uint8_t RF24_getDynamicPayloadSize(void) {
 	uint8_t result = RF24_spiMultiByteTransfer(R_RX_PL_WID,NULL,1,true);
 	// check if payload size invalid
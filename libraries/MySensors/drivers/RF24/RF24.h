@@ -227,6 +227,7 @@ LOCAL void RF24_startListening(void);
 LOCAL void RF24_stopListening(void);
 LOCAL void RF24_powerDown(void); 
 LOCAL bool RF24_sendMessage(uint8_t recipient, const void* buf, uint8_t len);
+LOCAL uint8_t RF24_getObserveTX(void);
 LOCAL uint8_t RF24_getDynamicPayloadSize(void);
 LOCAL bool RF24_isDataAvailable(uint8_t* to);
 LOCAL uint8_t RF24_readMessage(void* buf); 
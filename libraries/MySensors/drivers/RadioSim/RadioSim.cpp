@@ -0,0 +1,484 @@
+/*
+* The MySensors Arduino library handles the wireless radio link and protocol
+* between your home built sensors/actuators and HA controller of choice.
+* The sensors forms a self healing radio network with optional repeaters. Each
+* repeater and gateway builds a routing tables in EEPROM which keeps track of the
+* network topology allowing messages to be routed to nodes.
+*
+* Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+* Copyright (C) 2013-2015 Sensnology AB
+* Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+*
+* Documentation: http://www.mysensors.org
+* Support Forum: http://forum.mysensors.org
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* version 2 as published by the Free Software Foundation.
+*
+* Discrete-event medium and scheduler for the simulated radio (simulator side).
+* The medium models an nRF24L01+ at 250kbps with the auto-ack/retry settings of
+* MyTransportNRF24: unicast frames are retried up to RF24_ARC times, a receiver with a
+* full RX FIFO does not ack, and retransmissions of an already received frame are acked
+* but dropped (like the ESB packet id), unless radioSimSetDeliverRetries() is used to
+* model radios that retry in software. Broadcasts are sent once without ack.
+*/
+
+#include "RadioSim.h"
+#include <dlfcn.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <queue>
+#include <vector>
+
+#define RADIOSIM_MAX_NODES 255
+#define RADIOSIM_MAX_FRAME 32
+#define RADIOSIM_BYTE_US 32 // 250kbps
+#define RADIOSIM_OVERHEAD_BYTES 9 // preamble, address, PCF and CRC
+#define RADIOSIM_SETTLE_US 130 // TX/RX turnaround
+#define RADIOSIM_RETRY_DELAY_US 1500 // RF24_ARD
+#define RADIOSIM_RETRIES 15 // RF24_ARC
+#define RADIOSIM_FIFO_DEPTH 3
+#define RADIOSIM_STACK_SIZE (256 * 1024)
+
+// MyMessage header fields inspected for statistics (see MyMessage.h)
+#define RADIOSIM_HDR_DESTINATION 2
+#define RADIOSIM_HDR_COMMAND 4
+#define RADIOSIM_HDR_TYPE 5
+#define RADIOSIM_C_INTERNAL 3
+#define RADIOSIM_I_FIND_PARENT 7
+#define RADIOSIM_GATEWAY_ADDRESS 0
+
+// Node EEPROM layout (see MyEepromAddresses.h)
+#define RADIOSIM_EEPROM_NODE_ID 0
+#define RADIOSIM_EEPROM_PARENT 1
+#define RADIOSIM_EEPROM_DISTANCE 2
+
+struct SimFrame {
+	uint8_t to;
+	uint8_t len;
+	uint8_t data[RADIOSIM_MAX_FRAME];
+	uint64_t sentAt;
+};
+
+struct SimLink {
+	bool inRange;
+	float loss;
+	uint32_t latency;
+};
+
+struct SimStats {
+	uint32_t txFrames;
+	uint32_t txAttempts;
+	uint32_t txFailed;
+	uint32_t rxFrames;
+	uint32_t rxOverflow;
+	uint32_t findParent;
+	uint64_t latencySum;
+	uint32_t latencyMax;
+};
+
+struct SimNode {
+	int index;
+	void* lib;
+	RadioSimMainFunc main;
+	ucontext_t ctx;
+	void* stack;
+	bool started;
+	uint8_t nodeId;
+	uint8_t address;
+	bool listening;
+	uint8_t lastRetries; // Of the last unicast send
+	std::deque<SimFrame> rx;
+	uint8_t* config; // The node's own EEPROM image, valid once it has read its config
+	SimStats stats;
+};
+
+struct SimEvent {
+	uint64_t at;
+	uint64_t seq; // Keeps events at the same time in FIFO order
+	SimNode* node;
+	SimFrame* frame; // Delayed delivery to node, NULL to resume node
+	bool operator>(const SimEvent& other) const {
+		return at != other.at ? at > other.at : seq > other.seq;
+	}
+};
+
+static std::vector<SimNode*> _simNodes;
+static SimLink _simLinks[RADIOSIM_MAX_NODES][RADIOSIM_MAX_NODES];
+static std::priority_queue<SimEvent, std::vector<SimEvent>, std::greater<SimEvent> > _simEvents;
+static uint64_t _simSeq;
+static uint64_t _simNow;
+static uint64_t _simEnd;
+static uint32_t _simTick = 1000;
+static bool _simDeliverRetries = false;
+static uint32_t _simRandom = 2463534242UL;
+static SimNode* _simCurrent;
+static ucontext_t _simSchedulerCtx;
+
+// Network wide statistics
+static std::vector<uint32_t> _simFindParentPerSecond;
+static uint32_t _simGatewayMessages;
+
+static uint32_t simRandom() {
+	// xorshift32, independent from the random() the nodes share
+	_simRandom ^= _simRandom << 13;
+	_simRandom ^= _simRandom >> 17;
+	_simRandom ^= _simRandom << 5;
+	return _simRandom;
+}
+
+static bool simLost(float loss) {
+	return loss > 0 && simRandom() < loss * 4294967295.0;
+}
+
+static uint32_t simAirtime(uint8_t len) {
+	return RADIOSIM_SETTLE_US + (len + RADIOSIM_OVERHEAD_BYTES) * RADIOSIM_BYTE_US;
+}
+
+static void simSchedule(SimNode* node, uint64_t at, SimFrame* frame) {
+	SimEvent ev = { at, _simSeq++, node, frame };
+	_simEvents.push(ev);
+}
+
+static void simSuspend(uint32_t us) {
+	SimNode* self = _simCurrent;
+	uint64_t at = _simNow + us;
+	if (at <= _simEnd && (_simEvents.empty() || _simEvents.top().at > at)) {
+		// Nothing else happens in the meantime, skip the context switch
+		_simNow = at;
+		return;
+	}
+	simSchedule(self, at, NULL);
+	swapcontext(&self->ctx, &_simSchedulerCtx);
+}
+
+static void simDeliver(SimNode* node, const SimFrame& frame) {
+	if (!node->listening) {
+		return;
+	}
+	if (node->rx.size() >= RADIOSIM_FIFO_DEPTH) {
+		node->stats.rxOverflow++;
+		return;
+	}
+	node->rx.push_back(frame);
+}
+
+static SimNode* simFindAddress(uint8_t address) {
+	for (size_t i = 0; i < _simNodes.size(); i++) {
+		if (_simNodes[i]->address == address) {
+			return _simNodes[i];
+		}
+	}
+	return NULL;
+}
+
+static uint64_t simHostMicros() {
+	return _simNow;
+}
+
+static void simHostIdle(uint32_t us) {
+	simSuspend(us ? us : _simTick);
+}
+
+static bool simHostSend(uint8_t to, const void* data, uint8_t len) {
+	SimNode* self = _simCurrent;
+	if (len > RADIOSIM_MAX_FRAME) {
+		return false;
+	}
+	SimFrame frame;
+	frame.to = to;
+	frame.len = len;
+	memcpy(frame.data, data, len);
+	frame.sentAt = _simNow;
+	self->stats.txFrames++;
+	self->listening = true;
+
+	if (len > RADIOSIM_HDR_TYPE && (frame.data[RADIOSIM_HDR_COMMAND] & 0x07) == RADIOSIM_C_INTERNAL &&
+		frame.data[RADIOSIM_HDR_TYPE] == RADIOSIM_I_FIND_PARENT) {
+		self->stats.findParent++;
+		size_t second = _simNow / 1000000;
+		if (_simFindParentPerSecond.size() <= second) {
+			_simFindParentPerSecond.resize(second + 1);
+		}
+		_simFindParentPerSecond[second]++;
+	}
+
+	uint32_t airtime = simAirtime(len);
+	self->lastRetries = 0;
+	if (to == RADIOSIM_BROADCAST) {
+		self->stats.txAttempts++;
+		simSuspend(airtime);
+		for (size_t i = 0; i < _simNodes.size(); i++) {
+			const SimLink& link = _simLinks[self->index][i];
+			if (!link.inRange || simLost(link.loss)) {
+				continue;
+			}
+			if (link.latency) {
+				simSchedule(_simNodes[i], _simNow + link.latency, new SimFrame(frame));
+			} else {
+				simDeliver(_simNodes[i], frame);
+			}
+		}
+		return true;
+	}
+
+	SimNode* dest = simFindAddress(to);
+	bool received = false;
+	for (uint8_t attempt = 0; attempt <= RADIOSIM_RETRIES; attempt++) {
+		self->stats.txAttempts++;
+		self->lastRetries = attempt;
+		const SimLink* link = dest ? &_simLinks[self->index][dest->index] : NULL;
+		simSuspend(airtime + (link ? link->latency : 0));
+		if (link && link->inRange && dest->listening && !simLost(link->loss)) {
+			bool ack = received && !_simDeliverRetries;
+			if (!ack && dest->rx.size() < RADIOSIM_FIFO_DEPTH) {
+				dest->rx.push_back(frame);
+				received = ack = true;
+			} else if (!ack) {
+				// Full RX FIFO, the receiver drops the frame and sends no ack
+				dest->stats.rxOverflow++;
+			}
+			if (ack) {
+				const SimLink& back = _simLinks[dest->index][self->index];
+				simSuspend(simAirtime(0));
+				if (back.inRange && !simLost(back.loss)) {
+					return true;
+				}
+			}
+		}
+		if (attempt < RADIOSIM_RETRIES) {
+			simSuspend(RADIOSIM_RETRY_DELAY_US);
+		}
+	}
+	self->stats.txFailed++;
+	return false;
+}
+
+static bool simHostAvailable(uint8_t* to) {
+	SimNode* self = _simCurrent;
+	self->listening = true;
+	if (self->rx.empty()) {
+		return false;
+	}
+	if (to) {
+		*to = self->rx.front().to;
+	}
+	return true;
+}
+
+static uint8_t simHostReceive(void* data) {
+	SimNode* self = _simCurrent;
+	self->listening = true;
+	if (self->rx.empty()) {
+		return 0;
+	}
+	SimFrame frame = self->rx.front();
+	self->rx.pop_front();
+	memcpy(data, frame.data, frame.len);
+
+	uint32_t latency = (uint32_t)(_simNow - frame.sentAt);
+	self->stats.rxFrames++;
+	self->stats.latencySum += latency;
+	if (latency > self->stats.latencyMax) {
+		self->stats.latencyMax = latency;
+	}
+	if (self->address == RADIOSIM_GATEWAY_ADDRESS && frame.len > RADIOSIM_HDR_DESTINATION &&
+		frame.data[RADIOSIM_HDR_DESTINATION] == RADIOSIM_GATEWAY_ADDRESS) {
+		_simGatewayMessages++;
+	}
+	return frame.len;
+}
+
+static void simHostSetAddress(uint8_t address) {
+	_simCurrent->address = address;
+	_simCurrent->listening = true;
+}
+
+static void simHostPowerDown() {
+	_simCurrent->listening = false;
+}
+
+static void simHostLoadConfig(uint8_t* buf, size_t len) {
+	SimNode* self = _simCurrent;
+	self->config = buf;
+	if (len > RADIOSIM_EEPROM_NODE_ID) {
+		buf[RADIOSIM_EEPROM_NODE_ID] = self->nodeId;
+	}
+}
+
+static uint8_t simHostLastRetries() {
+	return _simCurrent->lastRetries;
+}
+
+static const RadioSimHost _simHost = {
+	simHostMicros,
+	simHostIdle,
+	simHostSend,
+	simHostAvailable,
+	simHostReceive,
+	simHostSetAddress,
+	simHostPowerDown,
+	simHostLoadConfig,
+	simHostLastRetries
+};
+
+static void simNodeStart() {
+	_simCurrent->main();
+}
+
+int radioSimAddNode(const char* sharedObject, uint8_t nodeId) {
+	if (_simNodes.size() >= RADIOSIM_MAX_NODES) {
+		fprintf(stderr, "Too many nodes\n");
+		return -1;
+	}
+	// The dynamic loader only maps a path once, so every node gets its own copy
+	FILE* src = fopen(sharedObject, "rb");
+	if (!src) {
+		fprintf(stderr, "Could not open %s\n", sharedObject);
+		return -1;
+	}
+	char path[] = "/tmp/radiosim-XXXXXX.so";
+	int fd = mkstemps(path, 3);
+	if (fd < 0) {
+		fclose(src);
+		fprintf(stderr, "Could not create copy of %s\n", sharedObject);
+		return -1;
+	}
+	char buf[4096];
+	size_t len;
+	bool ok = true;
+	while (ok && (len = fread(buf, 1, sizeof(buf), src)) > 0) {
+		ok = write(fd, buf, len) == (ssize_t)len;
+	}
+	fclose(src);
+	close(fd);
+	void* lib = ok ? dlopen(path, RTLD_NOW | RTLD_LOCAL) : NULL;
+	unlink(path);
+	if (!lib) {
+		fprintf(stderr, "Could not load %s: %s\n", sharedObject, ok ? dlerror() : "copy failed");
+		return -1;
+	}
+	RadioSimAttachFunc attach = (RadioSimAttachFunc)dlsym(lib, RADIOSIM_ATTACH_SYMBOL);
+	RadioSimMainFunc main = (RadioSimMainFunc)dlsym(lib, RADIOSIM_MAIN_SYMBOL);
+	if (!attach || !main) {
+		fprintf(stderr, "%s is not built with MY_RADIO_SIM\n", sharedObject);
+		dlclose(lib);
+		return -1;
+	}
+	attach(&_simHost);
+
+	SimNode* node = new SimNode();
+	node->index = _simNodes.size();
+	node->lib = lib;
+	node->main = main;
+	node->stack = malloc(RADIOSIM_STACK_SIZE);
+	node->nodeId = nodeId;
+	node->address = RADIOSIM_BROADCAST;
+	getcontext(&node->ctx);
+	node->ctx.uc_stack.ss_sp = node->stack;
+	node->ctx.uc_stack.ss_size = RADIOSIM_STACK_SIZE;
+	node->ctx.uc_link = &_simSchedulerCtx;
+	makecontext(&node->ctx, simNodeStart, 0);
+	_simNodes.push_back(node);
+	return node->index;
+}
+
+void radioSimSetLink(int a, int b, float loss, uint32_t latencyUs) {
+	SimLink& link = _simLinks[a][b];
+	link.inRange = true;
+	link.loss = loss;
+	link.latency = latencyUs;
+}
+
+void radioSimSetSeed(uint32_t seed) {
+	_simRandom = seed ? seed : 2463534242UL;
+}
+
+void radioSimSetTick(uint32_t us) {
+	_simTick = us ? us : 1;
+}
+
+void radioSimSetDeliverRetries(bool deliver) {
+	_simDeliverRetries = deliver;
+}
+
+void radioSimRun(uint32_t seconds) {
+	_simEnd = _simNow + (uint64_t)seconds * 1000000;
+	for (size_t i = 0; i < _simNodes.size(); i++) {
+		if (!_simNodes[i]->started) {
+			_simNodes[i]->started = true;
+			simSchedule(_simNodes[i], _simNow, NULL);
+		}
+	}
+	while (!_simEvents.empty() && _simEvents.top().at <= _simEnd) {
+		SimEvent ev = _simEvents.top();
+		_simEvents.pop();
+		_simNow = ev.at;
+		if (ev.frame) {
+			simDeliver(ev.node, *ev.frame);
+			delete ev.frame;
+			continue;
+		}
+		_simCurrent = ev.node;
+		swapcontext(&_simSchedulerCtx, &ev.node->ctx);
+		_simCurrent = NULL;
+	}
+	_simNow = _simEnd;
+}
+
+void radioSimPrintStats(FILE* out, bool perNode) {
+	SimStats total;
+	memset(&total, 0, sizeof(total));
+	uint32_t withParent = 0;
+	uint32_t distanceSum = 0;
+	if (perNode) {
+		fprintf(out, "node  id addr parent dist      tx attempts  failed      rx  ovf  find lat(avg/max us)\n");
+	}
+	for (size_t i = 0; i < _simNodes.size(); i++) {
+		const SimNode* node = _simNodes[i];
+		const SimStats& s = node->stats;
+		uint8_t parent = node->config ? node->config[RADIOSIM_EEPROM_PARENT] : 0xFF;
+		uint8_t distance = node->config ? node->config[RADIOSIM_EEPROM_DISTANCE] : 0xFF;
+		if (node->address != RADIOSIM_GATEWAY_ADDRESS && parent != 0xFF) {
+			withParent++;
+			distanceSum += distance;
+		}
+		total.txFrames += s.txFrames;
+		total.txAttempts += s.txAttempts;
+		total.txFailed += s.txFailed;
+		total.rxFrames += s.rxFrames;
+		total.rxOverflow += s.rxOverflow;
+		total.findParent += s.findParent;
+		total.latencySum += s.latencySum;
+		if (s.latencyMax > total.latencyMax) {
+			total.latencyMax = s.latencyMax;
+		}
+		if (perNode) {
+			fprintf(out, "%4u %3u %4u %6u %4u %7u %8u %7u %7u %4u %5u %8u/%u\n",
+				(unsigned)i, node->nodeId, node->address, parent, distance,
+				s.txFrames, s.txAttempts, s.txFailed, s.rxFrames, s.rxOverflow, s.findParent,
+				s.rxFrames ? (unsigned)(s.latencySum / s.rxFrames) : 0, s.latencyMax);
+		}
+	}
+	uint32_t peakFindParent = 0;
+	for (size_t i = 0; i < _simFindParentPerSecond.size(); i++) {
+		if (_simFindParentPerSecond[i] > peakFindParent) {
+			peakFindParent = _simFindParentPerSecond[i];
+		}
+	}
+	double seconds = _simNow / 1000000.0;
+	fprintf(out, "Simulated time:   %.1f s, %u nodes\n", seconds, (unsigned)_simNodes.size());
+	fprintf(out, "Frames sent:      %u (%u attempts, %u failed)\n", total.txFrames, total.txAttempts, total.txFailed);
+	fprintf(out, "Frames received:  %u (%u RX FIFO overflows)\n", total.rxFrames, total.rxOverflow);
+	fprintf(out, "Hop latency:      %u us avg, %u us max\n",
+		total.rxFrames ? (unsigned)(total.latencySum / total.rxFrames) : 0, total.latencyMax);
+	fprintf(out, "Find parent:      %u broadcasts, peak %u/s\n", total.findParent, peakFindParent);
+	fprintf(out, "To gateway:       %u messages, %.1f msg/s\n", _simGatewayMessages,
+		seconds > 0 ? _simGatewayMessages / seconds : 0);
+	fprintf(out, "Nodes with parent: %u/%u, %.2f hops avg\n", withParent,
+		_simNodes.empty() ? 0 : (unsigned)_simNodes.size() - 1, withParent ? (double)distanceSum / withParent : 0);
+}
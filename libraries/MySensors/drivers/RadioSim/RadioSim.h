@@ -0,0 +1,87 @@
+/*
+* The MySensors Arduino library handles the wireless radio link and protocol
+* between your home built sensors/actuators and HA controller of choice.
+* The sensors forms a self healing radio network with optional repeaters. Each
+* repeater and gateway builds a routing tables in EEPROM which keeps track of the
+* network topology allowing messages to be routed to nodes.
+*
+* Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+* Copyright (C) 2013-2015 Sensnology AB
+* Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+*
+* Documentation: http://www.mysensors.org
+* Support Forum: http://forum.mysensors.org
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* version 2 as published by the Free Software Foundation.
+*
+* Simulated radio medium for running a whole MySensors network in one Linux process.
+*
+* Every node is an unmodified sketch built for Linux with MY_RADIO_SIM as a shared object.
+* The simulator loads one private copy of that object per node (so each node has its own
+* _nc, _msg, routing table and EEPROM image) and runs them as coroutines on a virtual clock.
+* The node side only sees the RadioSimHost function table below, the medium (links, loss,
+* latency, auto-ack/retries, RX FIFO depth and statistics) lives in RadioSim.cpp.
+*/
+
+#ifndef __RADIOSIM_H__
+#define __RADIOSIM_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Broadcast address used by the simulated radio (matches BROADCAST_ADDRESS)
+#define RADIOSIM_BROADCAST 0xFF
+
+/**
+ * @brief Services provided by the simulator to the node currently running.
+ */
+typedef struct {
+	uint64_t (*micros)(void); //!< Virtual clock in microseconds
+	void (*idle)(uint32_t us); //!< Hand over to other nodes; resume after us (0 = next tick)
+	bool (*send)(uint8_t to, const void* data, uint8_t len); //!< Send with auto-ack, blocks for the airtime
+	bool (*available)(uint8_t* to); //!< Frame waiting in RX FIFO (to is its destination address)
+	uint8_t (*receive)(void* data); //!< Pop frame from RX FIFO
+	void (*setAddress)(uint8_t address); //!< Set address and start listening
+	void (*powerDown)(void); //!< Stop listening until next radio access
+	void (*loadConfig)(uint8_t* buf, size_t len); //!< Initial EEPROM image of this node
+	uint8_t (*lastRetries)(void); //!< Retransmissions needed by the last send
+} RadioSimHost;
+
+// Entry points exported by a node built with MY_RADIO_SIM
+#define RADIOSIM_ATTACH_SYMBOL "simNodeAttach"
+#define RADIOSIM_MAIN_SYMBOL "simNodeMain"
+
+typedef void (*RadioSimAttachFunc)(const RadioSimHost* host);
+typedef void (*RadioSimMainFunc)(void);
+
+#if defined(MY_RADIO_SIM)
+	// Node side: set by simNodeAttach() before simNodeMain() runs
+	extern const RadioSimHost* _simHost;
+	#define RADIOSIM_EXPORT extern "C" __attribute__((visibility("default")))
+#else
+	// Simulator side (RadioSim.cpp)
+	#include <stdio.h>
+
+	/**
+	 * @brief Load a private copy of a node shared object.
+	 * @param sharedObject Path of the sketch built with MY_RADIO_SIM
+	 * @param nodeId Node id written to the initial EEPROM image (0 for the gateway)
+	 * @return Index of the node, -1 on error
+	 */
+	int radioSimAddNode(const char* sharedObject, uint8_t nodeId);
+	/**
+	 * @brief Define the one-way link from node index a to b (nodes are out of range by default).
+	 * @param loss Probability (0..1) that a single frame is lost on this link
+	 * @param latencyUs Extra delay per frame on top of the airtime
+	 */
+	void radioSimSetLink(int a, int b, float loss, uint32_t latencyUs);
+	void radioSimSetSeed(uint32_t seed); //!< Seed of the medium's loss generator
+	void radioSimSetTick(uint32_t us); //!< Virtual time a node spends per poll (default 1000us)
+	void radioSimSetDeliverRetries(bool deliver); //!< Retransmissions after a lost ack reach the node again (no packet id)
+	void radioSimRun(uint32_t seconds); //!< Run all nodes for seconds of virtual time
+	void radioSimPrintStats(FILE* out, bool perNode); //!< Print medium and routing statistics
+#endif
+
+#endif // __RADIOSIM_H__
@@ -0,0 +1,241 @@
+/*
+* The MySensors Arduino library handles the wireless radio link and protocol
+* between your home built sensors/actuators and HA controller of choice.
+* The sensors forms a self healing radio network with optional repeaters. Each
+* repeater and gateway builds a routing tables in EEPROM which keeps track of the
+* network topology allowing messages to be routed to nodes.
+*
+* Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+* Copyright (C) 2013-2015 Sensnology AB
+* Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+*
+* Documentation: http://www.mysensors.org
+* Support Forum: http://forum.mysensors.org
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* version 2 as published by the Free Software Foundation.
+*
+* SPI bus with one emulated NOR flash chip, stands in for <SPI.h> when drivers/SPIFlash is
+* built for Linux (MY_OTA_FIRMWARE_FEATURE in the radio simulator, host tools). The chip
+* answers the commands SPIFlash sends: it needs write enable before program/erase, programming
+* only clears bits and wraps at the end of the 256 byte page, erases set whole sectors to 0xFF.
+* Program and erase take time like on a real chip, the status register reads busy meanwhile and
+* other commands are ignored. Whatever a real chip would do differently from what the caller
+* likely meant (wrapping within a page, programming over data, commands while busy) is counted
+* in SimFlashStats. A frame starts with SPI.begin(), which SPIFlash::select() calls for every
+* command.
+*/
+
+#ifndef __SIMFLASH_H__
+#define __SIMFLASH_H__
+
+#include <stdint.h>
+#include <string.h>
+#if defined(MY_RADIO_SIM)
+	#include "RadioSim.h"
+#endif
+
+#ifndef SIMFLASH_SIZE
+#define SIMFLASH_SIZE 0x20000UL // 1 Mbit
+#endif
+#ifndef SIMFLASH_JEDECID
+#define SIMFLASH_JEDECID MY_OTA_FLASH_JDECID
+#endif
+#define SIMFLASH_PAGE_SIZE 256
+
+// Busy times in microseconds, in the range datasheets of small SPI NOR chips give as typical
+#ifndef SIMFLASH_PROGRAM_US
+#define SIMFLASH_PROGRAM_US 200 // Per program command
+#endif
+#ifndef SIMFLASH_PROGRAM_BYTE_US
+#define SIMFLASH_PROGRAM_BYTE_US 2 // Per byte programmed
+#endif
+#ifndef SIMFLASH_ERASE_4K_US
+#define SIMFLASH_ERASE_4K_US 45000UL
+#endif
+#ifndef SIMFLASH_ERASE_32K_US
+#define SIMFLASH_ERASE_32K_US 120000UL
+#endif
+#ifndef SIMFLASH_ERASE_64K_US
+#define SIMFLASH_ERASE_64K_US 150000UL
+#endif
+#ifndef SIMFLASH_ERASE_CHIP_US
+#define SIMFLASH_ERASE_CHIP_US 1000000UL
+#endif
+
+// Saved and restored by SPIFlash around its transfers
+static uint8_t SPCR;
+static uint8_t SPSR;
+
+#define SPI_MODE0 0x00
+#define SPI_CLOCK_DIV4 0x00
+#ifndef MSBFIRST
+#define MSBFIRST 1
+#endif
+
+/// @brief What the emulated chip was asked to do
+typedef struct {
+	uint32_t programs; //!< Page program commands
+	uint32_t programmedBytes; //!< Bytes sent with them
+	uint32_t pageWraps; //!< Program commands that ran past the end of their page and wrapped
+	uint32_t overwrites; //!< Bytes programmed where a bit had to go from 0 to 1 (not erased)
+	uint32_t erases; //!< Sector, block and chip erases
+	uint32_t ignored; //!< Commands sent while busy (other than status reads) and writes without write enable
+	uint32_t busyMicros; //!< Time spent programming and erasing
+} SimFlashStats;
+
+/** @brief Emulated flash chip on the SPI bus */
+class SimFlash {
+public:
+	SimFlash() : _position(0), _writeEnabled(false), _duration(0), _lastTransfer(0), _busyUntil(0) {
+		memset(_memory, 0xFF, sizeof(_memory));
+		memset(&_stats, 0, sizeof(_stats));
+	}
+	void begin() {
+		// Chip select, the previous command is over and the chip starts programming or erasing
+		if (_duration) {
+			_busyUntil = _lastTransfer + _duration;
+			_stats.busyMicros += _duration;
+			_duration = 0;
+			_writeEnabled = false;
+		}
+		_position = 0;
+	}
+	void end() {}
+	void setDataMode(uint8_t mode) { (void)mode; }
+	void setBitOrder(uint8_t order) { (void)order; }
+	void setClockDivider(uint8_t divider) { (void)divider; }
+	uint8_t transfer(uint8_t data) {
+		uint32_t position = _position++;
+		if (!position) {
+			_command = data;
+			_address = 0;
+			_ignore = busy() && _command != 0x05;
+			if (_ignore) {
+				_stats.ignored++;
+				return 0;
+			}
+			if (_command == 0x06) { // SPIFLASH_WRITEENABLE
+				_writeEnabled = true;
+			} else if (_command == 0x04) { // SPIFLASH_WRITEDISABLE
+				_writeEnabled = false;
+			} else if (_command == 0x60 || _command == 0xC7) { // SPIFLASH_CHIPERASE
+				if (started()) {
+					memset(_memory, 0xFF, sizeof(_memory));
+					_stats.erases++;
+					_duration = SIMFLASH_ERASE_CHIP_US;
+				}
+			} else if (_command == 0x02) { // SPIFLASH_BYTEPAGEPROGRAM
+				_wrapped = false;
+			}
+			return 0;
+		}
+		if (_ignore) {
+			return 0;
+		}
+		switch (_command) {
+			case 0x05: // SPIFLASH_STATUSREAD
+				if (busy()) {
+					// Lets the simulated time pass while the caller waits
+					yield();
+					return 0x03;
+				}
+				return _writeEnabled ? 0x02 : 0x00;
+			case 0x9F: // SPIFLASH_IDREAD
+				return position == 1 ? SIMFLASH_JEDECID >> 8 : SIMFLASH_JEDECID & 0xFF;
+		}
+		if (position <= 3) {
+			_address = (_address << 8 | data) % SIMFLASH_SIZE;
+			if (position == 3) {
+				if (_command == 0x20) { // SPIFLASH_BLOCKERASE_4K
+					erase(0x1000, SIMFLASH_ERASE_4K_US);
+				} else if (_command == 0x52) { // SPIFLASH_BLOCKERASE_32K
+					erase(0x8000, SIMFLASH_ERASE_32K_US);
+				} else if (_command == 0xD8) { // SPIFLASH_BLOCKERASE_64K
+					erase(0x10000, SIMFLASH_ERASE_64K_US);
+				} else if (_command == 0x02 && started()) {
+					_stats.programs++;
+					_duration = SIMFLASH_PROGRAM_US;
+				}
+			}
+			return 0;
+		}
+		switch (_command) {
+			case 0x03: // SPIFLASH_ARRAYREADLOWFREQ
+				return _memory[(_address + position - 4) % SIMFLASH_SIZE];
+			case 0x0B: // SPIFLASH_ARRAYREAD, one dummy byte first
+				return position == 4 ? 0 : _memory[(_address + position - 5) % SIMFLASH_SIZE];
+			case 0x02: // SPIFLASH_BYTEPAGEPROGRAM
+				if (_duration) {
+					uint32_t offset = (_address & (SIMFLASH_PAGE_SIZE - 1)) + position - 4;
+					if (offset >= SIMFLASH_PAGE_SIZE && !_wrapped) {
+						_wrapped = true;
+						_stats.pageWraps++;
+					}
+					uint8_t* byte = &_memory[(_address & ~(uint32_t)(SIMFLASH_PAGE_SIZE - 1)) + offset % SIMFLASH_PAGE_SIZE];
+					if ((*byte & data) != data) {
+						_stats.overwrites++;
+					}
+					*byte &= data;
+					_stats.programmedBytes++;
+					_duration += SIMFLASH_PROGRAM_BYTE_US;
+					_lastTransfer = now();
+				}
+				return 0;
+		}
+		return 0;
+	}
+	/// True while programming or erasing
+	bool busy() {
+		return (int32_t)(_busyUntil - now()) > 0;
+	}
+	/// Contents of the chip, for checks from the host side
+	const uint8_t* memory() const {
+		return _memory;
+	}
+	/// Counters since the start or the last reset
+	SimFlashStats& stats() {
+		return _stats;
+	}
+private:
+	static uint32_t now() {
+		#if defined(MY_RADIO_SIM)
+			// Without handing over to other nodes, unlike micros()
+			return (uint32_t)_simHost->micros();
+		#else
+			return micros();
+		#endif
+	}
+	// Program and erase need write enable, else the chip ignores them
+	bool started() {
+		if (!_writeEnabled) {
+			_stats.ignored++;
+			return false;
+		}
+		_lastTransfer = now();
+		return true;
+	}
+	void erase(uint32_t size, uint32_t duration) {
+		if (started()) {
+			memset(&_memory[_address & ~(size - 1)], 0xFF, size);
+			_stats.erases++;
+			_duration = duration;
+		}
+	}
+	uint8_t _memory[SIMFLASH_SIZE];
+	SimFlashStats _stats;
+	uint8_t _command;
+	uint32_t _address;
+	uint32_t _position;
+	bool _writeEnabled;
+	bool _ignore;
+	bool _wrapped;
+	uint32_t _duration; // Of the program or erase started by the current command
+	uint32_t _lastTransfer;
+	uint32_t _busyUntil;
+};
+
+static SimFlash SPI;
+
+#endif
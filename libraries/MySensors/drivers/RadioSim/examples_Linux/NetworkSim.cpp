@@ -0,0 +1,143 @@
+/*
+* The MySensors Arduino library handles the wireless radio link and protocol
+* between your home built sensors/actuators and HA controller of choice.
+* The sensors forms a self healing radio network with optional repeaters. Each
+* repeater and gateway builds a routing tables in EEPROM which keeps track of the
+* network topology allowing messages to be routed to nodes.
+*
+* Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+* Copyright (C) 2013-2015 Sensnology AB
+* Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+*
+* Documentation: http://www.mysensors.org
+* Support Forum: http://forum.mysensors.org
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* version 2 as published by the Free Software Foundation.
+*
+* Runs a gateway and up to 254 sensor nodes on the simulated radio and reports
+* throughput, hop latency and parent search statistics. From this directory:
+*
+*   g++ -O2 -fPIC -shared -fvisibility=hidden SimGateway.cpp -I../../.. -I../../Linux -o SimGateway.so
+*   g++ -O2 -fPIC -shared -fvisibility=hidden SimSensor.cpp -I../../.. -I../../Linux -o SimSensor.so
+*   g++ -O2 NetworkSim.cpp ../RadioSim.cpp -I.. -o NetworkSim -ldl
+*   ./NetworkSim -n 250 -t grid -s 600 ./SimGateway.so ./SimSensor.so
+*
+* Node output (serial and debug prints) is discarded unless -v is given.
+*/
+
+#include "RadioSim.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void usage(const char* name) {
+	fprintf(stderr,
+		"Usage: %s [options] gateway.so node.so\n"
+		"  -n count     sensor nodes (1-254, default 25)\n"
+		"  -t topology  chain, grid or random (default grid)\n"
+		"  -s seconds   simulated time (default 300)\n"
+		"  -l loss      frame loss per link 0..1 (default 0.05)\n"
+		"  -d us        extra latency per link (default 0)\n"
+		"  -k us        virtual time per node poll (default 1000)\n"
+		"  -r seed      seed for topology and loss (default 1)\n"
+		"  -u           deliver retransmissions again (software retries, no packet id)\n"
+		"  -p           print per node statistics\n"
+		"  -v           keep node output\n", name);
+	exit(EXIT_FAILURE);
+}
+
+static void addLink(int a, int b, float loss, uint32_t latency) {
+	radioSimSetLink(a, b, loss, latency);
+	radioSimSetLink(b, a, loss, latency);
+}
+
+int main(int argc, char** argv) {
+	int count = 25;
+	const char* topology = "grid";
+	uint32_t seconds = 300;
+	float loss = 0.05;
+	uint32_t latency = 0;
+	uint32_t seed = 1;
+	bool perNode = false;
+	bool verbose = false;
+	int opt;
+	while ((opt = getopt(argc, argv, "n:t:s:l:d:k:r:upv")) != -1) {
+		switch (opt) {
+			case 'n': count = atoi(optarg); break;
+			case 't': topology = optarg; break;
+			case 's': seconds = atoi(optarg); break;
+			case 'l': loss = atof(optarg); break;
+			case 'd': latency = atoi(optarg); break;
+			case 'k': radioSimSetTick(atoi(optarg)); break;
+			case 'r': seed = atoi(optarg); break;
+			case 'u': radioSimSetDeliverRetries(true); break;
+			case 'p': perNode = true; break;
+			case 'v': verbose = true; break;
+			default: usage(argv[0]);
+		}
+	}
+	if (argc - optind != 2 || count < 1 || count > 254) {
+		usage(argv[0]);
+	}
+	radioSimSetSeed(seed);
+	srandom(seed);
+
+	// Node index equals node id, the gateway is index 0
+	if (radioSimAddNode(argv[optind], 0) < 0) {
+		return EXIT_FAILURE;
+	}
+	for (int i = 1; i <= count; i++) {
+		if (radioSimAddNode(argv[optind + 1], i) < 0) {
+			return EXIT_FAILURE;
+		}
+	}
+
+	int nodes = count + 1;
+	if (!strcmp(topology, "chain")) {
+		for (int i = 1; i < nodes; i++) {
+			addLink(i - 1, i, loss, latency);
+		}
+	} else if (!strcmp(topology, "grid")) {
+		// Row by row with the gateway in a corner, each node hears its 8 neighbours
+		int side = (int)ceil(sqrt(nodes));
+		for (int i = 0; i < nodes; i++) {
+			for (int j = i + 1; j < nodes; j++) {
+				if (abs(i % side - j % side) <= 1 && abs(i / side - j / side) <= 1) {
+					addLink(i, j, loss, latency);
+				}
+			}
+		}
+	} else if (!strcmp(topology, "random")) {
+		// Uniform in a unit square, gateway in the middle, range for ~8 neighbours.
+		// Loss grows towards the edge of the range.
+		double range = sqrt(8.0 / (M_PI * nodes));
+		double* x = new double[nodes];
+		double* y = new double[nodes];
+		for (int i = 0; i < nodes; i++) {
+			x[i] = i ? random() / (double)RAND_MAX : 0.5;
+			y[i] = i ? random() / (double)RAND_MAX : 0.5;
+		}
+		for (int i = 0; i < nodes; i++) {
+			for (int j = i + 1; j < nodes; j++) {
+				double d = hypot(x[i] - x[j], y[i] - y[j]) / range;
+				if (d <= 1.0) {
+					addLink(i, j, loss + (1 - loss) * 0.3 * d * d, latency);
+				}
+			}
+		}
+		delete[] x;
+		delete[] y;
+	} else {
+		usage(argv[0]);
+	}
+
+	if (!verbose && !freopen("/dev/null", "w", stdout)) {
+		fprintf(stderr, "Could not discard node output\n");
+	}
+	radioSimRun(seconds);
+	radioSimPrintStats(stderr, perNode);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,81 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ *******************************
+ *
+ * DESCRIPTION
+ * Serial gateway for the network simulator that also plays the controller's part in OTA
+ * updates (see examples_Linux/OtaServer), to benchmark a rollout with SimOtaNode.cpp.
+ * Firmware specs "type:version:image.hex" are taken from OTA_FIRMWARE (space separated),
+ * OTA_PARALLEL limits the transfers at a time. Statistics go to stderr at exit.
+ *
+ *   g++ -O2 -fPIC -shared -fvisibility=hidden SimOtaGateway.cpp -I../../.. -I../../Linux -o SimOtaGateway.so
+ *   g++ -O2 -fPIC -shared -fvisibility=hidden SimOtaNode.cpp -I../../.. -I../../Linux -o SimOtaNode.so
+ *   OTA_FIRMWARE="1:2:node.hex" OTA_PARALLEL=20 ./NetworkSim -n 200 -t grid -s 3600 ./SimOtaGateway.so ./SimOtaNode.so
+ */
+
+// Enable simulated radio
+#define MY_RADIO_SIM
+
+// Enable serial gateway
+#define MY_GATEWAY_SERIAL
+
+#include <MySensor.h>
+#include "examples_Linux/OtaServer/OtaServer.h"
+
+#define POLL_INTERVAL 100 // Milliseconds between timeout checks
+
+static OtaServer server;
+static MyMessage reply;
+static unsigned long lastPoll;
+
+static void printStats() {
+	otaServerPrintStats(&server, stderr);
+}
+
+void setup() {
+	const char* parallel = getenv("OTA_PARALLEL");
+	otaServerInit(&server, parallel ? atoi(parallel) : 0);
+	char specs[1024];
+	snprintf(specs, sizeof(specs), "%s", getenv("OTA_FIRMWARE") ? getenv("OTA_FIRMWARE") : "");
+	char* next;
+	for (char* spec = strtok_r(specs, " ", &next); spec; spec = strtok_r(NULL, " ", &next)) {
+		if (!otaServerAddFirmware(&server, spec)) {
+			fprintf(stderr, "Cannot load firmware %s\n", spec);
+		}
+	}
+	atexit(printStats);
+}
+
+void presentation() {
+}
+
+void loop() {
+	if (millis() - lastPoll >= POLL_INTERVAL) {
+		lastPoll = millis();
+		while (otaServerPoll(&server, reply, lastPoll)) {
+			_sendRoute(reply);
+		}
+	}
+}
+
+void receive(const MyMessage &message) {
+	if (otaServerProcess(&server, message.sender, message, reply, millis())) {
+		_sendRoute(reply);
+	}
+}
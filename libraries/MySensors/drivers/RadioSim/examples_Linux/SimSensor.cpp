@@ -0,0 +1,49 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ *******************************
+ *
+ * DESCRIPTION
+ * Repeating sensor for the network simulator (see NetworkSim.cpp). Every node
+ * forwards traffic for its children and reports a value at a jittered interval.
+ */
+
+// Enable simulated radio
+#define MY_RADIO_SIM
+
+// Enabled repeater feature for this node
+#define MY_REPEATER_FEATURE
+
+#include <MySensor.h>
+
+#define CHILD_ID 0
+#define REPORT_INTERVAL 30000 // Milliseconds between reports
+
+MyMessage msg(CHILD_ID, V_TEMP);
+int value;
+
+void presentation() {
+	sendSketchInfo("Sim Sensor", "1.0");
+	present(CHILD_ID, S_TEMP);
+}
+
+void loop() {
+	send(msg.set(value++));
+	// Jitter keeps the nodes from reporting in lockstep
+	wait(REPORT_INTERVAL / 2 + random(REPORT_INTERVAL));
+}
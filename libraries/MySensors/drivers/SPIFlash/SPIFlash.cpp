@@ -230,30 +230,60 @@ void SPIFlash::writeByte(uint32_t addr, uint8_t byt) {
 /// WARNING: you can only write to previously erased memory locations (see datasheet)
 ///          use the block erase commands to first clear memory (write 0xFFs)
 /// This version handles both page alignment and data blocks larger than 256 bytes.
-///
+/// Each page goes out in one program command, the last one is still running on return.
 void SPIFlash::writeBytes(uint32_t addr, const void* buf, uint16_t len) {
-  uint16_t n;
-  uint16_t maxBytes = 256-(addr%256);  // force the first set of bytes to stay within the first page
-  uint16_t offset = 0;
-  while (len>0)
+  const uint8_t* data = (const uint8_t*) buf;
+  while (len > 0)
   {
-    n = (len<=maxBytes) ? len : maxBytes;
-    command(SPIFLASH_BYTEPAGEPROGRAM, true);  // Byte/Page Program
-    SPI.transfer(addr >> 16);
-    SPI.transfer(addr >> 8);
-    SPI.transfer(addr);
-    
-    for (uint16_t i = 0; i < n; i++)
-      SPI.transfer(((uint8_t*) buf)[offset + i]);
-    unselect();
-    
-    addr+=n;  // adjust the addresses and remaining bytes by what we've just transferred.
-    offset +=n;
+    uint16_t n = programStart(addr, data, len); // 0 until the previous page is programmed
+    addr += n;
+    data += n;
     len -= n;
-    maxBytes = 256;   // now we can do up to 256 bytes per loop
   }
 }
 
+/// start programming at addr, at most up to the end of its page (the chip would wrap around)
+/// returns the number of bytes taken from buf, 0 if the chip is still busy and nothing was sent
+/// WARNING: you can only write to previously erased memory locations (see datasheet)
+uint16_t SPIFlash::programStart(uint32_t addr, const void* buf, uint16_t len) {
+  if (busy())
+    return 0;
+  uint16_t n = SPIFLASH_PAGESIZE - (addr % SPIFLASH_PAGESIZE);
+  if (len < n)
+    n = len;
+  writeCommand(SPIFLASH_BYTEPAGEPROGRAM, addr);  // Byte/Page Program
+  for (uint16_t i = 0; i < n; i++)
+    SPI.transfer(((const uint8_t*) buf)[i]);
+  unselect();
+  return n;
+}
+
+/// start erasing the block at addr, cmd is one of SPIFLASH_BLOCKERASE_4K/32K/64K
+/// returns false if the chip is still busy and nothing was sent
+boolean SPIFlash::eraseStart(uint8_t cmd, uint32_t addr) {
+  if (busy())
+    return false;
+  writeCommand(cmd, addr);
+  unselect();
+  return true;
+}
+
+/// send write enable, cmd and the address, the chip must not be busy
+void SPIFlash::writeCommand(uint8_t cmd, uint32_t addr) {
+#if defined(__AVR_ATmega32U4__) // Arduino Leonardo, MoteinoLeo
+  DDRB |= B00000001;            // Make sure the SS pin (PB0 - used by RFM12B on MoteinoLeo R1) is set as output HIGH!
+  PORTB |= B00000001;
+#endif
+  select();
+  SPI.transfer(SPIFLASH_WRITEENABLE);
+  unselect();
+  select();
+  SPI.transfer(cmd);
+  SPI.transfer(addr >> 16);
+  SPI.transfer(addr >> 8);
+  SPI.transfer(addr);
+}
+
 /// erase entire flash memory array
 /// may take several seconds depending on size, but is non blocking
 /// so you may wait for this to complete using busy() or continue doing
@@ -283,6 +313,15 @@ void SPIFlash::blockErase32K(uint32_t addr) {
   unselect();
 }
 
+/// erase a 64Kbyte block
+void SPIFlash::blockErase64K(uint32_t addr) {
+  command(SPIFLASH_BLOCKERASE_64K, true); // Block Erase
+  SPI.transfer(addr >> 16);
+  SPI.transfer(addr >> 8);
+  SPI.transfer(addr);
+  unselect();
+}
+
 void SPIFlash::sleep() {
   command(SPIFLASH_SLEEP);
   unselect();
@@ -35,14 +35,19 @@
 #ifndef _SPIFLASH_H_
 #define _SPIFLASH_H_
 
-#if ARDUINO >= 100
+#if ARDUINO >= 100 || defined(__linux__)
 #include <Arduino.h>
 #else
 #include <wiring.h>
 #include "pins_arduino.h"
 #endif
 
+#if defined(__linux__)
+// No SPI bus on Linux builds, the chip is emulated for the radio simulator
+#include "../RadioSim/SimFlash.h"
+#else
 #include <SPI.h>
+#endif
 
 /// IMPORTANT: NAND FLASH memory requires erase before write, because
 ///            it can only transition from 1s to 0s and only the erase command can reset all 0s to 1s
@@ -86,6 +91,13 @@
                                               // Example for Atmel-Adesto 4Mbit AT25DF041A: 0x1F44 (page 27: http://www.adestotech.com/sites/default/files/datasheets/doc3668.pdf)
                                               // Example for Winbond 4Mbit W25X40CL: 0xEF30 (page 14: http://www.winbond.com/NR/rdonlyres/6E25084C-0BFE-4B25-903D-AE10221A0929/0/W25X40CL.pdf)
 #define SPIFLASH_MACREAD          0x4B        // read unique ID number (MAC)
+
+#define SPIFLASH_PAGESIZE         256         // a program command wraps around at the end of its page
+
+/// Program and erase run on the chip after the command has been sent. The functions below
+/// return once the operation is started, busy() tells when it has completed. Any other command
+/// first waits for completion, except eraseStart() and programStart(), which return right away
+/// without starting anything while the chip is busy, so the caller can do other work meanwhile.
                                               
 /** SPIFlash class */
 class SPIFlash {
@@ -99,10 +111,13 @@ public:
   void readBytes(uint32_t addr, void* buf, uint16_t len); //!< read unlimited # of bytes
   void writeByte(uint32_t addr, uint8_t byt); //!< Write 1 byte to flash memory
   void writeBytes(uint32_t addr, const void* buf, uint16_t len); //!< write multiple bytes to flash memory (up to 64K)
+  uint16_t programStart(uint32_t addr, const void* buf, uint16_t len); //!< Start programming up to the end of the page, returns the bytes taken (0 while busy)
+  boolean eraseStart(uint8_t cmd, uint32_t addr); //!< Start SPIFLASH_BLOCKERASE_* of the block at addr, returns false while busy
   boolean busy(); //!< check if the chip is busy erasing/writing
   void chipErase(); //!< erase entire flash memory array
   void blockErase4K(uint32_t address); //!< erase a 4Kbyte block
   void blockErase32K(uint32_t address); //!< erase a 32Kbyte block
+  void blockErase64K(uint32_t address); //!< erase a 64Kbyte block
   uint16_t readDeviceId(); //!< Get the manufacturer and device ID bytes (as a short word)
   uint8_t* readUniqueId(); //!< Get the 64 bit unique identifier, stores it in @ref UNIQUEID[8]
   
@@ -112,6 +127,7 @@ public:
 protected:
   void select(); //!< select
   void unselect(); //!< unselect
+  void writeCommand(uint8_t cmd, uint32_t addr); //!< Write enable, then cmd and addr without waiting, leaves the chip selected
   uint8_t _slaveSelectPin; //!< Slave select pin
   uint16_t _jedecID; //!< JEDEC ID
   uint8_t _SPCR; //!< SPCR
@@ -0,0 +1,175 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ *******************************
+ *
+ * DESCRIPTION
+ * Known answer tests and host benchmark for the AES-CCM mode used by the nRF24 transport
+ * (MY_RF24_ENCRYPTION_CCM). The RFC 3610 vectors are checked with and without their
+ * tag, then the per frame cost of encrypting and decrypting a message the way
+ * MyTransportNRF24.cpp does is compared with the CBC path, together with the frame size
+ * that goes on air.
+ *
+ *   g++ -O2 AesBenchmark.cpp -I../.. -o AesBenchmark
+ *   ./AesBenchmark
+ */
+
+#include "drivers/AES/AES.cpp"
+#include <time.h>
+
+#define ROUNDS 200000
+
+typedef struct {
+	const char* name;
+	uint8_t nonce[CCM_NONCE_BYTES];
+	uint8_t aadLength;
+	uint8_t length;
+	uint8_t macSize;
+	uint8_t expected[40]; // Ciphertext, then tag
+} kat_t;
+
+// RFC 3610 packet vectors 1 and 2 (key C0...CF, AAD 00...07, plaintext 08, 09, ...)
+static const kat_t _kats[] = {
+	{ "RFC3610 #1", { 0x00, 0x00, 0x00, 0x03, 0x02, 0x01, 0x00, 0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5 }, 8, 23, 8, {
+		0x58, 0x8C, 0x97, 0x9A, 0x61, 0xC6, 0x63, 0xD2, 0xF0, 0x66, 0xD0, 0xC2, 0xC0, 0xF9, 0x89, 0x80,
+		0x6D, 0x5F, 0x6B, 0x61, 0xDA, 0xC3, 0x84, 0x17, 0xE8, 0xD1, 0x2C, 0xFD, 0xF9, 0x26, 0xE0 } },
+	{ "RFC3610 #2", { 0x00, 0x00, 0x00, 0x04, 0x03, 0x02, 0x01, 0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5 }, 8, 24, 8, {
+		0x72, 0xC9, 0x1A, 0x36, 0xE1, 0x35, 0xF8, 0xCF, 0x29, 0x1C, 0xA8, 0x94, 0x08, 0x5C, 0x87, 0xE3,
+		0xCC, 0x15, 0xC4, 0x39, 0xC9, 0xE4, 0x3A, 0x3B, 0xA0, 0x91, 0xD5, 0x6E, 0x10, 0x40, 0x09, 0x16 } },
+};
+
+static AES _aes;
+static volatile uint8_t _sink; // Keeps the benchmark loops from being optimized away
+
+static int runKats(void) {
+	int tests = 0;
+	int failures = 0;
+	uint8_t key[16], aad[8];
+	for (int i = 0; i < 16; i++) {
+		key[i] = 0xC0 + i;
+	}
+	for (int i = 0; i < 8; i++) {
+		aad[i] = i;
+	}
+	_aes.set_key(key, 16);
+	for (size_t k = 0; k < sizeof(_kats) / sizeof(_kats[0]); k++) {
+		kat_t kat = _kats[k];
+		uint8_t plain[32], data[32], mac[16];
+		for (int i = 0; i < kat.length; i++) {
+			plain[i] = 8 + i;
+		}
+		// The ciphertext does not depend on the tag size, 0 is the unauthenticated mode
+		const uint8_t macSizes[] = { kat.macSize, 0 };
+		for (int m = 0; m < 2; m++) {
+			memcpy(data, plain, kat.length);
+			_aes.ccm_encrypt(kat.nonce, aad, kat.aadLength, data, kat.length, mac, macSizes[m]);
+			if (memcmp(data, kat.expected, kat.length) ||
+				memcmp(mac, &kat.expected[kat.length], macSizes[m])) {
+				printf("FAIL %s encrypt, tag of %d\n", kat.name, macSizes[m]);
+				failures++;
+			}
+			if (_aes.ccm_decrypt(kat.nonce, aad, kat.aadLength, data, kat.length, mac, macSizes[m]) != AES_SUCCESS ||
+				memcmp(data, plain, kat.length)) {
+				printf("FAIL %s decrypt, tag of %d\n", kat.name, macSizes[m]);
+				failures++;
+			}
+			tests += 2;
+		}
+		// A changed bit anywhere is caught by the tag
+		_aes.ccm_encrypt(kat.nonce, aad, kat.aadLength, data, kat.length, mac, kat.macSize);
+		data[kat.length - 1] ^= 0x01;
+		if (_aes.ccm_decrypt(kat.nonce, aad, kat.aadLength, data, kat.length, mac, kat.macSize) == AES_SUCCESS) {
+			printf("FAIL %s accepts a changed ciphertext\n", kat.name);
+			failures++;
+		}
+		tests++;
+	}
+	printf("%d known answer tests, %d failures\n", tests, failures);
+	return failures;
+}
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Encrypts and decrypts a message of length bytes ROUNDS times as the CBC path does,
+// returns the time per frame in us
+static double benchCbc(uint8_t length, uint8_t* frameLength) {
+	uint8_t frame[32];
+	memset(frame, 0x5A, sizeof(frame));
+	*frameLength = length > 16 ? 32 : 16;
+	double start = now();
+	for (int r = 0; r < ROUNDS; r++) {
+		frame[1] = r;
+		_aes.set_IV(0);
+		_aes.cbc_encrypt(frame, frame, *frameLength / 16);
+		_aes.set_IV(0);
+		_aes.cbc_decrypt(frame, frame, *frameLength / 16);
+		_sink += frame[0];
+	}
+	return (now() - start) / ROUNDS * 1e6;
+}
+
+// The same with CCM: the first byte (transmitting node) stays in clear, a 3 byte counter
+// and the tag follow the message
+static double benchCcm(uint8_t length, uint8_t macSize, uint8_t* frameLength) {
+	uint8_t frame[32 + 16], nonce[CCM_NONCE_BYTES];
+	memset(frame, 0x5A, sizeof(frame));
+	memset(nonce, 0, sizeof(nonce));
+	*frameLength = length + 3 + macSize;
+	double start = now();
+	for (int r = 0; r < ROUNDS; r++) {
+		nonce[0] = frame[0];
+		nonce[3] = frame[length + 2] = r;
+		_aes.ccm_encrypt(nonce, NULL, 0, &frame[1], length - 1, &frame[length + 3], macSize);
+		_aes.ccm_decrypt(nonce, NULL, 0, &frame[1], length - 1, &frame[length + 3], macSize);
+		_sink += frame[1];
+	}
+	return (now() - start) / ROUNDS * 1e6;
+}
+
+int main(void) {
+	int failures = runKats();
+
+	uint8_t key[16];
+	for (int i = 0; i < 16; i++) {
+		key[i] = i * 13 + 1;
+	}
+	_aes.set_key(key, 16);
+	// A 2 byte value, a 16 byte payload and the longest message CCM can carry (without a tag)
+	static const uint8_t lengths[] = { 9, 23, 29 };
+	printf("message  mode        frame  us/frame (encrypt + decrypt)\n");
+	for (size_t l = 0; l < sizeof(lengths); l++) {
+		uint8_t frameLength;
+		double cbc = benchCbc(lengths[l], &frameLength);
+		printf("%5d    CBC         %5d  %8.2f\n", lengths[l], frameLength, cbc);
+		static const uint8_t macSizes[] = { 0, 4, 8 };
+		for (size_t m = 0; m < sizeof(macSizes); m++) {
+			// The counter and tag share the 32 byte frame, longer messages cannot be sent
+			uint8_t length = lengths[l];
+			if (length > 32 - 3 - macSizes[m]) {
+				length = 32 - 3 - macSizes[m];
+			}
+			double ccm = benchCcm(length, macSizes[m], &frameLength);
+			printf("%5d    CCM, tag %d  %5d  %8.2f (%.1fx)\n", length, macSizes[m], frameLength, ccm, cbc / ccm);
+		}
+	}
+	return failures ? 1 : 0;
+}
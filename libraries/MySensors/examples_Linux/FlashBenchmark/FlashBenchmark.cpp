@@ -0,0 +1,139 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ *******************************
+ *
+ * DESCRIPTION
+ * Checks the SPIFlash driver against the emulated chip of drivers/RadioSim/SimFlash.h, which
+ * takes program and erase times of a real chip and counts page wraps, programming over data
+ * and commands sent while busy. Writes an OTA sized image once with writeBytes() and once
+ * in FIRMWARE_BLOCK_SIZE pieces, as the OTA code gets it, and compares program commands and
+ * chip time. Then starts an erase with eraseStart() and polls it, to show how much of the
+ * erase time the caller gets for other work, and finally makes sure the emulation catches a
+ * program command running over the end of its page.
+ *
+ *   g++ -O2 FlashBenchmark.cpp -I../.. -I../../drivers/Linux -o FlashBenchmark
+ *   ./FlashBenchmark
+ */
+
+#define MY_CORE_ONLY
+
+#include <MySensor.h>
+#include "core/MyTransport.h"
+#include "drivers/SPIFlash/SPIFlash.cpp"
+
+#define IMAGE_ADDRESS FIRMWARE_START_OFFSET // Not page aligned, as OTA writes it
+#define IMAGE_SIZE 0x7000UL
+
+static SPIFlash _flash(MY_OTA_FLASH_SS, MY_OTA_FLASH_JDECID);
+static uint8_t _image[IMAGE_SIZE];
+static int _failures;
+
+static void check(bool ok, const char* what) {
+	if (!ok) {
+		printf("FAIL %s\n", what);
+		_failures++;
+	}
+}
+
+static void waitReady() {
+	while (_flash.busy()) {
+	}
+}
+
+static void erase() {
+	_flash.blockErase32K(0);
+	waitReady();
+	SPI.stats() = SimFlashStats();
+}
+
+// Writes the image in pieces of the given size, returns the time taken in ms
+static double writeImage(uint16_t piece) {
+	erase();
+	unsigned long start = micros();
+	for (uint32_t offset = 0; offset < IMAGE_SIZE; offset += piece) {
+		uint16_t length = IMAGE_SIZE - offset < piece ? IMAGE_SIZE - offset : piece;
+		_flash.writeBytes(IMAGE_ADDRESS + offset, &_image[offset], length);
+	}
+	waitReady();
+	double elapsed = (micros() - start) / 1000.0;
+	const SimFlashStats& stats = SPI.stats();
+	check(!memcmp(SPI.memory() + IMAGE_ADDRESS, _image, IMAGE_SIZE), "image read back");
+	check(!stats.pageWraps && !stats.overwrites && !stats.ignored, "no wraps, overwrites or ignored commands");
+	printf("%5u byte writes  %5u programs  %7.1f ms chip  %7.1f ms total\n", piece, stats.programs,
+		stats.busyMicros / 1000.0, elapsed);
+	return elapsed;
+}
+
+int main() {
+	for (uint32_t i = 0; i < IMAGE_SIZE; i++) {
+		_image[i] = random(256);
+	}
+	if (!_flash.initialize()) {
+		printf("FAIL initialize\n");
+		return 1;
+	}
+
+	// One program command per page touched
+	writeImage(FIRMWARE_BLOCK_SIZE);
+	writeImage(IMAGE_SIZE);
+	uint32_t pages = (IMAGE_ADDRESS + IMAGE_SIZE - 1) / SPIFLASH_PAGESIZE - IMAGE_ADDRESS / SPIFLASH_PAGESIZE + 1;
+	check(SPI.stats().programs == pages, "one program command per page");
+
+	// Writing over data is what the emulation reports, not the driver
+	_flash.writeBytes(IMAGE_ADDRESS, _image + 1, FIRMWARE_BLOCK_SIZE);
+	waitReady();
+	check(SPI.stats().overwrites > 0, "programming over data detected");
+
+	// Erase in the background
+	unsigned long start = micros();
+	check(_flash.eraseStart(SPIFLASH_BLOCKERASE_32K, 0), "erase started");
+	unsigned long started = micros() - start;
+	check(!_flash.eraseStart(SPIFLASH_BLOCKERASE_4K, 0), "no erase start while busy");
+	check(!_flash.programStart(0, _image, 1), "no program start while busy");
+	uint32_t polls = 0;
+	while (_flash.busy()) {
+		polls++;
+	}
+	unsigned long erased = micros() - start;
+	check(SPI.stats().ignored == 0, "nothing sent while busy");
+	check(erased >= SIMFLASH_ERASE_32K_US, "erase takes the chip's time");
+	check(SPI.memory()[IMAGE_ADDRESS] == 0xFF, "erased");
+	printf("32K erase: %lu us to start, %.1f ms until done, %u polls meanwhile\n", started, erased / 1000.0, polls);
+
+	// A program command crossing a page boundary wraps to the start of the page on a real chip
+	SPI.stats() = SimFlashStats();
+	const uint8_t data[2] = { 0x12, 0x34 };
+	_flash.command(SPIFLASH_BYTEPAGEPROGRAM, true);
+	SPI.transfer(0);
+	SPI.transfer(0);
+	SPI.transfer(SPIFLASH_PAGESIZE - 1);
+	SPI.transfer(data[0]);
+	SPI.transfer(data[1]);
+	_flash.command(SPIFLASH_STATUSREAD); // Ends the program command
+	SPI.transfer(0);
+	waitReady();
+	check(SPI.stats().pageWraps == 1 && SPI.memory()[0] == data[1], "page wrap detected");
+	// The driver splits at the page end
+	_flash.writeBytes(2 * SPIFLASH_PAGESIZE - 1, data, sizeof(data));
+	waitReady();
+	check(SPI.stats().pageWraps == 1 && SPI.memory()[2 * SPIFLASH_PAGESIZE] == data[1], "write split at page end");
+
+	printf("%d failures\n", _failures);
+	return _failures ? 1 : 0;
+}
@@ -0,0 +1,113 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ *******************************
+ *
+ * DESCRIPTION
+ * Encodes a firmware image for nodes built with MY_OTA_COMPRESSION_FEATURE. Prints the
+ * ReplyFirmwareConfig fields and the number of blocks a node fetches for the image as is,
+ * compressed and (given the firmware the node runs) as a delta, and writes the smallest
+ * of them. Every encoded image is decoded again and compared before it is used.
+ *
+ *   g++ -O2 OtaImage.cpp -I../.. -I../../drivers/Linux -o OtaImage
+ *   ./OtaImage new.hex [running.hex] [-o stream.bin]
+ */
+
+#define MY_CORE_ONLY
+
+#include <MySensor.h>
+#include "OtaImage.h"
+
+static OtaImage _image, _base, _decoded;
+static uint8_t _stream[OTA_IMAGE_MAX_SIZE];
+
+// Encodes with or without base, returns the blocks to fetch or 0 if no smaller than the image
+static uint32_t encode(const OtaImage* base, uint32_t* length) {
+	*length = otaImageEncode(&_image, base, _stream, sizeof(_stream));
+	if (*length > _image.size) {
+		return 0;
+	}
+	if (!otaImageDecode(_stream, *length, base, &_decoded, _image.size) ||
+		memcmp(_decoded.data, _image.data, _image.size)) {
+		fprintf(stderr, "encoded image does not decode to the image\n");
+		exit(EXIT_FAILURE);
+	}
+	return (*length + FIRMWARE_BLOCK_SIZE - 1) / FIRMWARE_BLOCK_SIZE;
+}
+
+int main(int argc, char** argv) {
+	const char* output = NULL;
+	const char* files[2] = { NULL, NULL };
+	int count = 0;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+			output = argv[++i];
+		} else if (count < 2) {
+			files[count++] = argv[i];
+		}
+	}
+	if (!count) {
+		fprintf(stderr, "Usage: %s new.hex [running.hex] [-o stream.bin]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (!otaImageLoad(files[0], &_image) || (files[1] && !otaImageLoad(files[1], &_base))) {
+		fprintf(stderr, "cannot load %s (at most %u bytes)\n", files[1] ? files[1] : files[0], (unsigned)OTA_IMAGE_MAX_SIZE);
+		return EXIT_FAILURE;
+	}
+	uint32_t blocks = _image.size / FIRMWARE_BLOCK_SIZE;
+	printf("blocks %u, crc 0x%04X\n", blocks, otaImageCrc(&_image));
+
+	uint8_t encoding = 0;
+	uint32_t streamBlocks = blocks;
+	uint32_t length;
+	uint32_t compressed = encode(NULL, &length);
+	printf("as is      %5u blocks\n", blocks);
+	if (compressed) {
+		printf("compressed %5u blocks (%.1f%%)\n", compressed, 100.0 * compressed / blocks);
+		encoding = FIRMWARE_ENCODING_LZ;
+		streamBlocks = compressed;
+	}
+	if (files[1]) {
+		uint32_t delta = encode(&_base, &length);
+		if (delta) {
+			printf("delta      %5u blocks (%.1f%%)\n", delta, 100.0 * delta / blocks);
+		}
+		if (delta && delta < streamBlocks) {
+			encoding = FIRMWARE_ENCODING_LZ | FIRMWARE_ENCODING_DELTA;
+			streamBlocks = delta;
+		}
+	}
+	printf("encoding %u, streamBlocks %u\n", encoding, streamBlocks);
+	if (output) {
+		FILE* file = fopen(output, "wb");
+		if (!file) {
+			perror(output);
+			return EXIT_FAILURE;
+		}
+		if (encoding) {
+			encode(encoding & FIRMWARE_ENCODING_DELTA ? &_base : NULL, &length);
+			// Padded to whole blocks, the node ignores what follows the last token
+			memset(&_stream[length], 0xFF, streamBlocks * FIRMWARE_BLOCK_SIZE - length);
+			fwrite(_stream, 1, streamBlocks * FIRMWARE_BLOCK_SIZE, file);
+		} else {
+			fwrite(_image.data, 1, _image.size, file);
+		}
+		fclose(file);
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,323 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ *******************************
+ *
+ * Controller side of OTA firmware images: loading Intel HEX (or raw binary) files,
+ * the checksum nodes verify and the encoder for MY_OTA_COMPRESSION_FEATURE nodes,
+ * see FIRMWARE_TOKEN_* in core/MyTransport.h for the format. A decoder following the
+ * node's rules checks every encoded image before it is offered.
+ */
+
+#ifndef OtaImage_h
+#define OtaImage_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "core/MyTransport.h"
+
+// Largest image, nodes keep it in the lower 32K of their flash
+#define OTA_IMAGE_MAX_SIZE FIRMWARE_STREAM_OFFSET
+// Candidates looked at per position when searching for matches
+#define OTA_MATCH_CHAIN 256
+#define OTA_HASH_SIZE 4096
+
+typedef struct {
+	uint8_t data[OTA_IMAGE_MAX_SIZE];
+	uint32_t size; // Multiple of FIRMWARE_BLOCK_SIZE, padded with 0xFF
+} OtaImage;
+
+static inline uint8_t otaHexByte(const char* s) {
+	uint8_t value = 0;
+	for (int i = 0; i < 2; i++) {
+		char c = s[i];
+		value = value << 4 | (c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+	}
+	return value;
+}
+
+// Loads a .hex file (Intel HEX as the Arduino IDE exports it) or, for any other name, raw binary
+static inline bool otaImageLoad(const char* path, OtaImage* image) {
+	FILE* file = fopen(path, "rb");
+	if (!file) {
+		return false;
+	}
+	memset(image->data, 0xFF, sizeof(image->data));
+	image->size = 0;
+	const char* extension = strrchr(path, '.');
+	bool ok = true;
+	if (extension && !strcasecmp(extension, ".hex")) {
+		char line[600];
+		uint32_t upper = 0;
+		while (ok && fgets(line, sizeof(line), file)) {
+			if (line[0] != ':') {
+				continue;
+			}
+			uint8_t length = otaHexByte(&line[1]);
+			uint32_t address = upper + (otaHexByte(&line[3]) << 8 | otaHexByte(&line[5]));
+			uint8_t type = otaHexByte(&line[7]);
+			uint8_t sum = 0;
+			for (int i = 0; i < length + 5; i++) {
+				sum += otaHexByte(&line[1 + 2 * i]);
+			}
+			if (sum) {
+				ok = false;
+			} else if (type == 0) {
+				if (address + length > OTA_IMAGE_MAX_SIZE) {
+					ok = false;
+					break;
+				}
+				for (int i = 0; i < length; i++) {
+					image->data[address + i] = otaHexByte(&line[9 + 2 * i]);
+				}
+				if (address + length > image->size) {
+					image->size = address + length;
+				}
+			} else if (type == 1) {
+				break;
+			} else if (type == 2) {
+				upper = (otaHexByte(&line[9]) << 8 | otaHexByte(&line[11])) << 4;
+			} else if (type == 4) {
+				upper = (otaHexByte(&line[9]) << 8 | otaHexByte(&line[11])) << 16;
+			}
+		}
+	} else {
+		uint8_t extra;
+		image->size = fread(image->data, 1, sizeof(image->data), file);
+		ok = !fread(&extra, 1, 1, file);
+	}
+	fclose(file);
+	image->size = (image->size + FIRMWARE_BLOCK_SIZE - 1) / FIRMWARE_BLOCK_SIZE * FIRMWARE_BLOCK_SIZE;
+	return ok && image->size;
+}
+
+// CRC-16 (0xA001 reflected, starting at 0xFFFF) as checked by the node
+static inline uint16_t otaImageCrc(const OtaImage* image) {
+	uint16_t crc = ~0;
+	for (uint32_t i = 0; i < image->size; i++) {
+		crc ^= image->data[i];
+		for (int8_t j = 0; j < 8; j++) {
+			crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+		}
+	}
+	return crc;
+}
+
+// Hash chains over 3 byte prefixes, next[i] is the previous position with the same hash
+typedef struct {
+	int32_t head[OTA_HASH_SIZE];
+	int32_t next[OTA_IMAGE_MAX_SIZE];
+} OtaMatcher;
+
+static inline uint32_t otaHash(const uint8_t* p) {
+	return ((p[0] << 8) ^ (p[1] << 4) ^ p[2]) % OTA_HASH_SIZE;
+}
+
+static inline void otaMatcherInit(OtaMatcher* matcher) {
+	for (int i = 0; i < OTA_HASH_SIZE; i++) {
+		matcher->head[i] = -1;
+	}
+}
+
+static inline void otaMatcherAdd(OtaMatcher* matcher, const OtaImage* image, uint32_t position) {
+	if (position + FIRMWARE_MATCH_MIN <= image->size) {
+		uint32_t hash = otaHash(&image->data[position]);
+		matcher->next[position] = matcher->head[hash];
+		matcher->head[hash] = position;
+	}
+}
+
+// Longest match of image at position among the positions in the matcher, returns its length
+static inline uint32_t otaMatcherFind(const OtaMatcher* matcher, const OtaImage* source, const OtaImage* image,
+	uint32_t position, uint32_t maxLength, uint32_t* found) {
+	uint32_t best = 0;
+	if (position + FIRMWARE_MATCH_MIN > image->size) {
+		return 0;
+	}
+	if (maxLength > image->size - position) {
+		maxLength = image->size - position;
+	}
+	int32_t candidate = matcher->head[otaHash(&image->data[position])];
+	for (int chain = 0; candidate >= 0 && chain < OTA_MATCH_CHAIN; chain++) {
+		uint32_t length = 0;
+		// Candidates of the image itself may run into the bytes being matched, as the node allows
+		while (length < maxLength && candidate + length < source->size &&
+			source->data[candidate + length] == image->data[position + length]) {
+			length++;
+		}
+		if (length > best) {
+			best = length;
+			*found = candidate;
+		}
+		candidate = matcher->next[candidate];
+	}
+	return best;
+}
+
+typedef struct {
+	uint32_t length; // 0 for a literal
+	uint32_t from;
+	bool base;
+} OtaToken;
+
+static inline int32_t otaGain(const OtaToken* token) {
+	return token->length ? (int32_t)token->length - (token->base ? 4 : 3) : 0;
+}
+
+static inline OtaToken otaBestToken(const OtaMatcher* history, const OtaMatcher* baseMatcher, const OtaImage* base,
+	const OtaImage* image, uint32_t position) {
+	OtaToken token = { 0, 0, false };
+	uint32_t from = 0;
+	uint32_t length = otaMatcherFind(history, image, image, position, 0x3F + FIRMWARE_MATCH_MIN, &from);
+	if (length >= FIRMWARE_MATCH_MIN) {
+		token.length = length;
+		token.from = position - from;
+	}
+	if (base) {
+		length = otaMatcherFind(baseMatcher, base, image, position, 0x4000, &from);
+		OtaToken copy = { length, from, true };
+		if (otaGain(&copy) > otaGain(&token)) {
+			token = copy;
+		}
+	}
+	if (otaGain(&token) <= 0) {
+		token.length = 0;
+	}
+	return token;
+}
+
+static inline uint32_t otaFlushLiterals(const OtaImage* image, uint32_t start, uint32_t end, uint8_t* out, uint32_t size, uint32_t length) {
+	while (start < end) {
+		uint32_t count = end - start > 128 ? 128 : end - start;
+		if (length + 1 + count > size) {
+			return size + 1;
+		}
+		out[length++] = FIRMWARE_TOKEN_LITERAL + count - 1;
+		memcpy(&out[length], &image->data[start], count);
+		length += count;
+		start += count;
+	}
+	return length;
+}
+
+// Encodes image, with references to base (the firmware running on the node) unless NULL.
+// Returns the length written to out, more than size if it did not fit.
+static inline uint32_t otaImageEncode(const OtaImage* image, const OtaImage* base, uint8_t* out, uint32_t size) {
+	static OtaMatcher history, baseMatcher;
+	otaMatcherInit(&history);
+	if (base) {
+		otaMatcherInit(&baseMatcher);
+		for (uint32_t i = 0; i < base->size; i++) {
+			otaMatcherAdd(&baseMatcher, base, i);
+		}
+	}
+	uint32_t length = 0;
+	uint32_t literals = 0;
+	uint32_t position = 0;
+	while (position < image->size) {
+		OtaToken token = otaBestToken(&history, &baseMatcher, base, image, position);
+		if (token.length) {
+			// One literal first if the next position gives a clearly better match
+			otaMatcherAdd(&history, image, position);
+			OtaToken next = otaBestToken(&history, &baseMatcher, base, image, position + 1);
+			if (otaGain(&next) > otaGain(&token) + 1) {
+				position++;
+				continue;
+			}
+			length = otaFlushLiterals(image, literals, position, out, size, length);
+			if (length + 4 > size) {
+				return size + 1;
+			}
+			if (token.base) {
+				out[length++] = FIRMWARE_TOKEN_BASE | (token.length - 1) >> 8;
+				out[length++] = (token.length - 1) & 0xFF;
+			} else {
+				out[length++] = FIRMWARE_TOKEN_MATCH | (token.length - FIRMWARE_MATCH_MIN);
+			}
+			out[length++] = token.from >> 8;
+			out[length++] = token.from & 0xFF;
+			for (uint32_t i = 1; i < token.length; i++) {
+				otaMatcherAdd(&history, image, position + i);
+			}
+			position += token.length;
+			literals = position;
+		} else {
+			otaMatcherAdd(&history, image, position);
+			position++;
+		}
+	}
+	return otaFlushLiterals(image, literals, position, out, size, length);
+}
+
+// Decodes as the node does, returns false where the node would give up
+static inline bool otaImageDecode(const uint8_t* stream, uint32_t length, const OtaImage* base, OtaImage* image, uint32_t size) {
+	uint32_t position = 0;
+	image->size = 0;
+	while (image->size < size) {
+		if (position >= length) {
+			return false;
+		}
+		uint8_t token = stream[position++];
+		uint32_t count, from;
+		const uint8_t* source;
+		if (token < FIRMWARE_TOKEN_MATCH) {
+			count = token - FIRMWARE_TOKEN_LITERAL + 1;
+			if (position + count > length) {
+				return false;
+			}
+			source = &stream[position];
+			position += count;
+		} else if (token < FIRMWARE_TOKEN_BASE) {
+			if (position + 2 > length) {
+				return false;
+			}
+			count = (token & 0x3F) + FIRMWARE_MATCH_MIN;
+			uint32_t distance = stream[position] << 8 | stream[position + 1];
+			position += 2;
+			if (!distance || distance > image->size || image->size + count > size) {
+				return false;
+			}
+			// Byte by byte, a copy may overlap its own output
+			from = image->size - distance;
+			for (uint32_t i = 0; i < count; i++) {
+				image->data[image->size++] = image->data[from + i];
+			}
+			continue;
+		} else {
+			if (!base || position + 3 > length) {
+				return false;
+			}
+			count = ((token & 0x3F) << 8 | stream[position]) + 1;
+			from = stream[position + 1] << 8 | stream[position + 2];
+			position += 3;
+			if (from + count > base->size) {
+				return false;
+			}
+			source = &base->data[from];
+		}
+		if (image->size + count > size) {
+			return false;
+		}
+		memcpy(&image->data[image->size], source, count);
+		image->size += count;
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,235 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ *******************************
+ *
+ * DESCRIPTION
+ * OTA firmware server for a serial or Ethernet gateway: takes the controller's part in
+ * firmware updates for any number of nodes at once (see OtaServer.h) and prints transfer
+ * statistics per node on Ctrl-C. Each image is given as "type:version:file" (Intel HEX or
+ * raw binary), the highest version of a type is sent to the nodes of that type and to
+ * nodes never updated, the lower ones serve as bases for delta images. Images are loaded
+ * again when their file changes.
+ *
+ *   g++ -O2 OtaServer.cpp -I../.. -I../../drivers/Linux -o OtaServer
+ *   ./OtaServer -d /dev/ttyUSB0 1:2:sensor-v2.hex 1:1:sensor-v1.hex
+ *   ./OtaServer -t 192.168.178.66:5003 -c 10 1:2:sensor-v2.hex
+ */
+
+#define MY_CORE_ONLY
+#define MY_GATEWAY_SERIAL
+
+#include <MySensor.h>
+#include "OtaServer.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <signal.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define POLL_INTERVAL 100 // Milliseconds between timeout checks
+
+static OtaServer _server;
+static volatile sig_atomic_t _stop;
+static bool _verbose;
+
+static void usage(const char* name) {
+	fprintf(stderr,
+		"Usage: %s [options] type:version:image.hex ...\n"
+		"  -d device    serial gateway (default /dev/ttyUSB0, 115200 baud)\n"
+		"  -t host:port Ethernet gateway\n"
+		"  -c count     transfers at a time (default no limit)\n"
+		"  -v           print the messages exchanged\n", name);
+	exit(EXIT_FAILURE);
+}
+
+static void onSignal(int signal) {
+	(void)signal;
+	_stop = 1;
+}
+
+static uint32_t now() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000UL + tv.tv_usec / 1000;
+}
+
+static int openSerial(const char* device) {
+	int fd = open(device, O_RDWR | O_NOCTTY);
+	if (fd < 0) {
+		return -1;
+	}
+	struct termios tio;
+	if (tcgetattr(fd, &tio)) {
+		close(fd);
+		return -1;
+	}
+	cfmakeraw(&tio);
+	cfsetispeed(&tio, B115200);
+	cfsetospeed(&tio, B115200);
+	tio.c_cflag |= CLOCAL | CREAD;
+	if (tcsetattr(fd, TCSANOW, &tio)) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static int openTcp(const char* address) {
+	char host[256];
+	snprintf(host, sizeof(host), "%s", address);
+	char* port = strrchr(host, ':');
+	if (!port) {
+		return -1;
+	}
+	*port++ = 0;
+	struct addrinfo hints, *result;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host, port, &hints, &result)) {
+		return -1;
+	}
+	int fd = -1;
+	for (struct addrinfo* ai = result; ai && fd < 0; ai = ai->ai_next) {
+		fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen)) {
+			close(fd);
+			fd = -1;
+		}
+	}
+	freeaddrinfo(result);
+	return fd;
+}
+
+static bool sendReply(int fd, MyMessage& reply) {
+	// Controllers write the destination where the gateway writes the sender
+	reply.sender = reply.destination;
+	const char* line = protocolFormat(reply);
+	if (_verbose) {
+		printf("< %s", line);
+	}
+	size_t length = strlen(line);
+	while (length) {
+		ssize_t written = write(fd, line, length);
+		if (written < 0 && errno != EINTR) {
+			return false;
+		}
+		if (written > 0) {
+			line += written;
+			length -= written;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+	const char* device = "/dev/ttyUSB0";
+	const char* address = NULL;
+	int parallel = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "d:t:c:v")) != -1) {
+		switch (opt) {
+			case 'd': device = optarg; break;
+			case 't': address = optarg; break;
+			case 'c': parallel = atoi(optarg); break;
+			case 'v': _verbose = true; break;
+			default: usage(argv[0]);
+		}
+	}
+	if (optind == argc || parallel < 0 || parallel > 255) {
+		usage(argv[0]);
+	}
+	otaServerInit(&_server, parallel);
+	for (int i = optind; i < argc; i++) {
+		if (!otaServerAddFirmware(&_server, argv[i])) {
+			fprintf(stderr, "Cannot load firmware %s (type:version:file, at most %u bytes)\n", argv[i],
+				(unsigned)OTA_IMAGE_MAX_SIZE);
+			return EXIT_FAILURE;
+		}
+		const OtaFirmware* firmware = &_server.firmwares[_server.firmwareCount - 1];
+		printf("firmware %u:%u, %u blocks, crc 0x%04X\n", firmware->type, firmware->version,
+			firmware->image.size / FIRMWARE_BLOCK_SIZE, firmware->crc);
+	}
+	int fd = address ? openTcp(address) : openSerial(device);
+	if (fd < 0) {
+		perror(address ? address : device);
+		return EXIT_FAILURE;
+	}
+	signal(SIGINT, onSignal);
+	signal(SIGTERM, onSignal);
+
+	char line[MY_GATEWAY_MAX_RECEIVE_LENGTH * 2];
+	size_t length = 0;
+	uint32_t lastPoll = now();
+	MyMessage message, reply;
+	while (!_stop) {
+		fd_set fds;
+		FD_ZERO(&fds);
+		FD_SET(fd, &fds);
+		struct timeval timeout = { 0, POLL_INTERVAL * 1000 };
+		int ready = select(fd + 1, &fds, NULL, NULL, &timeout);
+		if (ready < 0 && errno != EINTR) {
+			perror("select");
+			break;
+		}
+		if (ready > 0) {
+			char buffer[256];
+			ssize_t count = read(fd, buffer, sizeof(buffer));
+			if (count <= 0) {
+				fprintf(stderr, "gateway connection closed\n");
+				break;
+			}
+			for (ssize_t i = 0; i < count; i++) {
+				if (buffer[i] != '\n') {
+					// Overlong lines are dropped as a whole
+					if (length < sizeof(line) - 1) {
+						line[length] = buffer[i];
+					}
+					length++;
+					continue;
+				}
+				if (length < sizeof(line)) {
+					line[length] = 0;
+					if (_verbose) {
+						printf("> %s\n", line);
+					}
+					// The first field is the node the message comes from
+					if (protocolParse(message, line) &&
+						otaServerProcess(&_server, message.destination, message, reply, now()) &&
+						!sendReply(fd, reply)) {
+						_stop = 1;
+					}
+				}
+				length = 0;
+			}
+		}
+		if (now() - lastPoll >= POLL_INTERVAL) {
+			lastPoll = now();
+			while (otaServerPoll(&_server, reply, lastPoll) && sendReply(fd, reply)) {
+			}
+		}
+	}
+	close(fd);
+	otaServerPrintStats(&_server, stdout);
+	return EXIT_SUCCESS;
+}
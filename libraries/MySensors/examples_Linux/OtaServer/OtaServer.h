@@ -0,0 +1,438 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ *******************************
+ *
+ * Controller side of OTA updates for a whole network: answers the firmware config and
+ * block requests (C_STREAM) of any number of nodes at once and keeps transfer statistics
+ * per node. Images are parsed once and reloaded when their file changes, encoded images
+ * (see OtaImage.h) are cached per firmware, base and encoding. With a limit on parallel
+ * transfers the nodes above it wait and are offered the update when a transfer ends.
+ *
+ * The caller moves the messages: otaServerProcess() for every message from a node,
+ * otaServerPoll() now and then for timeouts and waiting nodes, both fill in the reply
+ * to send. Nodes only ask for their firmware config when they present themselves, the
+ * ones heard of without such a request are asked to present again (I_PRESENTATION).
+ */
+
+#ifndef OtaServer_h
+#define OtaServer_h
+
+#include <sys/stat.h>
+#include "../OtaImage/OtaImage.h"
+
+#define OTA_SERVER_MAX_FIRMWARES 8
+// One per firmware and base (or none), so the cache never evicts
+#define OTA_SERVER_MAX_STREAMS (OTA_SERVER_MAX_FIRMWARES * (OTA_SERVER_MAX_FIRMWARES + 1))
+#define OTA_SERVER_MAX_BLOCKS (OTA_IMAGE_MAX_SIZE / FIRMWARE_BLOCK_SIZE)
+#define OTA_SERVER_NO_STREAM 0xFF
+// Milliseconds without a block request before a transfer is given up, nodes give up after
+// MY_OTA_RETRY times MY_OTA_RETRY_DELAY
+#define OTA_SERVER_TIMEOUT 10000UL
+// Milliseconds between presentation requests to a node that did not ask for its firmware config
+// or gave up the transfer, and between any two of them (a presentation is several messages)
+#define OTA_SERVER_PRESENT_INTERVAL 30000UL
+#define OTA_SERVER_PRESENT_PACE 1000UL
+
+typedef enum {
+	OTA_NODE_UNKNOWN, // Did not ask for its firmware config (yet)
+	OTA_NODE_CURRENT, // Runs the firmware already
+	OTA_NODE_WAITING, // Waits for a free transfer slot
+	OTA_NODE_SENDING,
+	OTA_NODE_DONE, // Got every block
+	OTA_NODE_FAILED // Stopped asking for blocks, or never started
+} OtaNodeState;
+
+typedef struct {
+	char path[256];
+	time_t modified;
+	uint16_t type;
+	uint16_t version;
+	uint16_t crc;
+	OtaImage image;
+} OtaFirmware;
+
+typedef struct {
+	uint8_t firmware;
+	uint8_t base; // Firmware the delta is made against, OTA_SERVER_NO_STREAM if none
+	uint8_t encoding;
+	uint32_t blocks;
+	uint8_t data[OTA_IMAGE_MAX_SIZE];
+} OtaStream;
+
+typedef struct {
+	bool seen; // Sent anything
+	uint32_t asked; // Last presentation request
+	uint8_t state;
+	uint8_t encodings; // Offered in the node's config request
+	NodeFirmwareConfig running; // As reported by the node
+	uint8_t firmware;
+	uint8_t stream; // OTA_SERVER_NO_STREAM if sent as is
+	uint32_t blocks; // To send
+	uint32_t distinct; // Different blocks sent so far
+	uint32_t requests;
+	uint32_t started; // Milliseconds
+	uint32_t last;
+	uint32_t sent[(OTA_SERVER_MAX_BLOCKS + 31) / 32];
+} OtaNode;
+
+typedef struct {
+	OtaFirmware firmwares[OTA_SERVER_MAX_FIRMWARES];
+	uint8_t firmwareCount;
+	OtaStream streams[OTA_SERVER_MAX_STREAMS];
+	uint8_t streamCount;
+	OtaNode nodes[256];
+	uint8_t parallel; // Transfers at a time, 0 for no limit
+	uint8_t sending;
+	uint32_t asked; // Last presentation request
+} OtaServer;
+
+static inline void otaServerInit(OtaServer* server, uint8_t parallel) {
+	memset(server, 0, sizeof(*server));
+	server->parallel = parallel;
+}
+
+static inline void otaServerStop(OtaServer* server, OtaNode* state, uint8_t result) {
+	if (state->state == OTA_NODE_SENDING) {
+		server->sending--;
+	}
+	state->state = result;
+}
+
+// Nodes fetching from the dropped image stop, the others follow the moved entries
+static inline void otaServerDropStream(OtaServer* server, uint8_t index) {
+	for (uint16_t node = 0; node < 256; node++) {
+		OtaNode* state = &server->nodes[node];
+		if (state->state < OTA_NODE_SENDING || state->stream == OTA_SERVER_NO_STREAM || state->stream < index) {
+			continue;
+		}
+		if (state->stream == index) {
+			otaServerStop(server, state, OTA_NODE_FAILED);
+			state->stream = OTA_SERVER_NO_STREAM;
+		} else {
+			state->stream--;
+		}
+	}
+	memmove(&server->streams[index], &server->streams[index + 1], sizeof(OtaStream) * (--server->streamCount - index));
+}
+
+// Loads the file again if it changed, drops the encoded images made from the old one
+static inline bool otaServerRefresh(OtaServer* server, uint8_t index) {
+	OtaFirmware* firmware = &server->firmwares[index];
+	struct stat info;
+	if (stat(firmware->path, &info)) {
+		return false;
+	}
+	if (info.st_mtime == firmware->modified) {
+		return true;
+	}
+	if (!otaImageLoad(firmware->path, &firmware->image)) {
+		return false;
+	}
+	firmware->modified = info.st_mtime;
+	firmware->crc = otaImageCrc(&firmware->image);
+	for (uint16_t node = 0; node < 256; node++) {
+		if (server->nodes[node].state == OTA_NODE_SENDING && server->nodes[node].firmware == index) {
+			otaServerStop(server, &server->nodes[node], OTA_NODE_FAILED);
+		}
+	}
+	for (uint8_t i = 0; i < server->streamCount; ) {
+		if (server->streams[i].firmware == index || server->streams[i].base == index) {
+			otaServerDropStream(server, i);
+		} else {
+			i++;
+		}
+	}
+	return true;
+}
+
+// Adds "type:version:path", the highest version of a type is sent, the others serve as delta bases
+static inline bool otaServerAddFirmware(OtaServer* server, const char* spec) {
+	unsigned type, version;
+	int offset;
+	if (server->firmwareCount == OTA_SERVER_MAX_FIRMWARES ||
+		sscanf(spec, "%u:%u:%n", &type, &version, &offset) != 2 || type > 0xFFFF || version > 0xFFFF) {
+		return false;
+	}
+	OtaFirmware* firmware = &server->firmwares[server->firmwareCount];
+	memset(firmware, 0, sizeof(*firmware));
+	snprintf(firmware->path, sizeof(firmware->path), "%s", spec + offset);
+	firmware->type = type;
+	firmware->version = version;
+	if (!otaServerRefresh(server, server->firmwareCount)) {
+		return false;
+	}
+	server->firmwareCount++;
+	return true;
+}
+
+// Firmware for a node of the given type, nodes never updated (type 0xFFFF) get the first one loaded
+static inline uint8_t otaServerTarget(const OtaServer* server, uint16_t type) {
+	uint8_t target = OTA_SERVER_NO_STREAM;
+	for (uint8_t i = 0; i < server->firmwareCount; i++) {
+		const OtaFirmware* firmware = &server->firmwares[i];
+		if (firmware->type == type && (target == OTA_SERVER_NO_STREAM || firmware->version > server->firmwares[target].version)) {
+			target = i;
+		}
+	}
+	if (target == OTA_SERVER_NO_STREAM && type == 0xFFFF && server->firmwareCount) {
+		target = 0;
+	}
+	return target;
+}
+
+// Encoded image of firmware for the node (against base if not OTA_SERVER_NO_STREAM), OTA_SERVER_NO_STREAM if it does not pay off
+static inline uint8_t otaServerStream(OtaServer* server, uint8_t firmware, uint8_t base) {
+	uint8_t encoding = FIRMWARE_ENCODING_LZ | (base != OTA_SERVER_NO_STREAM ? FIRMWARE_ENCODING_DELTA : 0);
+	for (uint8_t i = 0; i < server->streamCount; i++) {
+		OtaStream* stream = &server->streams[i];
+		if (stream->firmware == firmware && stream->base == base && stream->encoding == encoding) {
+			return stream->blocks ? i : OTA_SERVER_NO_STREAM;
+		}
+	}
+	uint8_t index = server->streamCount++;
+	OtaStream* stream = &server->streams[index];
+	stream->firmware = firmware;
+	stream->base = base;
+	stream->encoding = encoding;
+	const OtaImage* image = &server->firmwares[firmware].image;
+	uint32_t length = otaImageEncode(image, base != OTA_SERVER_NO_STREAM ? &server->firmwares[base].image : NULL,
+		stream->data, sizeof(stream->data));
+	// Padded to whole blocks, the node ignores what follows the last token. Kept as a negative entry if no smaller.
+	stream->blocks = length < image->size ? (length + FIRMWARE_BLOCK_SIZE - 1) / FIRMWARE_BLOCK_SIZE : 0;
+	memset(&stream->data[length], 0xFF, sizeof(stream->data) - length);
+	return stream->blocks ? index : OTA_SERVER_NO_STREAM;
+}
+
+static inline void otaServerReply(MyMessage& reply, uint8_t node, uint8_t type, uint8_t length) {
+	mSetLength(reply, length);
+	mSetPayloadType(reply, P_CUSTOM);
+	build(reply, GATEWAY_ADDRESS, node, NODE_SENSOR_ID, C_STREAM, type, false);
+}
+
+// Picks the smallest image the node can decode and fills in the config response that starts the transfer
+static inline void otaServerStart(OtaServer* server, uint8_t node, MyMessage& reply, uint32_t now) {
+	OtaNode* state = &server->nodes[node];
+	const OtaFirmware* firmware = &server->firmwares[state->firmware];
+	state->stream = OTA_SERVER_NO_STREAM;
+	state->blocks = firmware->image.size / FIRMWARE_BLOCK_SIZE;
+	if (state->encodings & FIRMWARE_ENCODING_LZ) {
+		uint8_t stream = otaServerStream(server, state->firmware, OTA_SERVER_NO_STREAM);
+		if (stream != OTA_SERVER_NO_STREAM && server->streams[stream].blocks < state->blocks) {
+			state->stream = stream;
+			state->blocks = server->streams[stream].blocks;
+		}
+		for (uint8_t i = 0; (state->encodings & FIRMWARE_ENCODING_DELTA) && i < server->firmwareCount; i++) {
+			const OtaFirmware* base = &server->firmwares[i];
+			if (i == state->firmware || base->type != state->running.type ||
+				base->version != state->running.version || base->crc != state->running.crc) {
+				continue;
+			}
+			stream = otaServerStream(server, state->firmware, i);
+			if (stream != OTA_SERVER_NO_STREAM && server->streams[stream].blocks < state->blocks) {
+				state->stream = stream;
+				state->blocks = server->streams[stream].blocks;
+			}
+		}
+	}
+	memset(state->sent, 0, sizeof(state->sent));
+	state->distinct = 0;
+	state->requests = 0;
+	state->started = now;
+	state->last = now;
+	state->state = OTA_NODE_SENDING;
+	server->sending++;
+
+	ReplyFirmwareConfig* config = (ReplyFirmwareConfig*)reply.data;
+	config->type = firmware->type;
+	config->version = firmware->version;
+	config->blocks = firmware->image.size / FIRMWARE_BLOCK_SIZE;
+	config->crc = firmware->crc;
+	if (state->stream == OTA_SERVER_NO_STREAM) {
+		otaServerReply(reply, node, ST_FIRMWARE_CONFIG_RESPONSE, sizeof(NodeFirmwareConfig));
+	} else {
+		config->encoding = server->streams[state->stream].encoding;
+		config->streamBlocks = state->blocks;
+		otaServerReply(reply, node, ST_FIRMWARE_CONFIG_RESPONSE, sizeof(ReplyFirmwareConfig));
+	}
+}
+
+// Handles a message from node, returns true if reply is to be sent
+static inline bool otaServerProcess(OtaServer* server, uint8_t node, const MyMessage& message, MyMessage& reply, uint32_t now) {
+	OtaNode* state = &server->nodes[node];
+	if (node == GATEWAY_ADDRESS) {
+		return false;
+	}
+	if (!state->seen) {
+		// Its presentation may still be on the way
+		state->seen = true;
+		state->asked = now;
+	}
+	if (mGetCommand(message) != C_STREAM) {
+		return false;
+	}
+	if (message.type == ST_FIRMWARE_CONFIG_REQUEST) {
+		if (mGetLength(message) < sizeof(NodeFirmwareConfig)) {
+			return false;
+		}
+		const RequestFirmwareConfig* request = (const RequestFirmwareConfig*)message.data;
+		for (uint8_t i = 0; i < server->firmwareCount; i++) {
+			otaServerRefresh(server, i);
+		}
+		// A new request ends what was sent before, e.g. after a reboot or a failed delta
+		otaServerStop(server, state, OTA_NODE_UNKNOWN);
+		memcpy(&state->running, request, sizeof(NodeFirmwareConfig));
+		state->encodings = mGetLength(message) >= sizeof(RequestFirmwareConfig) ? request->encodings : 0;
+		state->firmware = otaServerTarget(server, request->type);
+		if (state->firmware == OTA_SERVER_NO_STREAM) {
+			return false;
+		}
+		const OtaFirmware* firmware = &server->firmwares[state->firmware];
+		if (firmware->type == request->type && firmware->version == request->version &&
+			firmware->crc == request->crc && firmware->image.size / FIRMWARE_BLOCK_SIZE == request->blocks) {
+			// Answered anyway, the node skips the update
+			state->state = OTA_NODE_CURRENT;
+			memcpy(reply.data, &state->running, sizeof(NodeFirmwareConfig));
+			otaServerReply(reply, node, ST_FIRMWARE_CONFIG_RESPONSE, sizeof(NodeFirmwareConfig));
+			return true;
+		}
+		if (server->parallel && server->sending >= server->parallel) {
+			state->state = OTA_NODE_WAITING;
+			return false;
+		}
+		otaServerStart(server, node, reply, now);
+		return true;
+	}
+	if (message.type == ST_FIRMWARE_REQUEST) {
+		const RequestFWBlock* request = (const RequestFWBlock*)message.data;
+		if (state->state < OTA_NODE_SENDING || mGetLength(message) < sizeof(RequestFWBlock) ||
+			request->block >= state->blocks) {
+			return false;
+		}
+		const OtaFirmware* firmware = &server->firmwares[state->firmware];
+		if (request->type != firmware->type || request->version != firmware->version) {
+			return false;
+		}
+		const uint8_t* data = state->stream == OTA_SERVER_NO_STREAM ? firmware->image.data :
+			server->streams[state->stream].data;
+		ReplyFWBlock* block = (ReplyFWBlock*)reply.data;
+		block->type = request->type;
+		block->version = request->version;
+		block->block = request->block;
+		memcpy(block->data, &data[request->block * FIRMWARE_BLOCK_SIZE], FIRMWARE_BLOCK_SIZE);
+		otaServerReply(reply, node, ST_FIRMWARE_RESPONSE, sizeof(ReplyFWBlock));
+
+		state->requests++;
+		state->last = now;
+		uint32_t bit = 1UL << (request->block & 31);
+		if (!(state->sent[request->block / 32] & bit)) {
+			state->sent[request->block / 32] |= bit;
+			if (++state->distinct == state->blocks) {
+				otaServerStop(server, state, OTA_NODE_DONE);
+			}
+		}
+		return true;
+	}
+	return false;
+}
+
+// Gives up stalled transfers, starts waiting ones and asks silent nodes to present.
+// Returns true with a reply to send, call again until false.
+static inline bool otaServerPoll(OtaServer* server, MyMessage& reply, uint32_t now) {
+	for (uint16_t node = 0; node < 256; node++) {
+		OtaNode* state = &server->nodes[node];
+		if (state->state == OTA_NODE_SENDING && now - state->last > OTA_SERVER_TIMEOUT) {
+			otaServerStop(server, state, OTA_NODE_FAILED);
+			state->asked = now;
+		}
+	}
+	for (uint16_t node = 0; node < 256 && (!server->parallel || server->sending < server->parallel); node++) {
+		if (server->nodes[node].state == OTA_NODE_WAITING) {
+			otaServerStart(server, node, reply, now);
+			return true;
+		}
+	}
+	if (!server->firmwareCount || (server->parallel && server->sending >= server->parallel) ||
+		now - server->asked < OTA_SERVER_PRESENT_PACE) {
+		return false;
+	}
+	// The one asked longest ago
+	OtaNode* oldest = NULL;
+	uint8_t node = 0;
+	for (uint16_t i = 0; i < 256; i++) {
+		OtaNode* state = &server->nodes[i];
+		if (state->seen && (state->state == OTA_NODE_UNKNOWN || state->state == OTA_NODE_FAILED) &&
+			now - state->asked >= OTA_SERVER_PRESENT_INTERVAL && (!oldest || now - state->asked > now - oldest->asked)) {
+			oldest = state;
+			node = i;
+		}
+	}
+	if (!oldest) {
+		return false;
+	}
+	oldest->asked = now;
+	server->asked = now;
+	mSetLength(reply, 0);
+	mSetPayloadType(reply, P_STRING);
+	build(reply, GATEWAY_ADDRESS, node, NODE_SENSOR_ID, C_INTERNAL, I_PRESENTATION, false);
+	return true;
+}
+
+// Per node transfer statistics and the time from the first transfer start to the last block
+static inline void otaServerPrintStats(const OtaServer* server, FILE* file) {
+	static const char* const states[] = { "unknown", "current", "waiting", "sending", "done", "failed" };
+	uint32_t first = 0, last = 0, bytes = 0;
+	uint16_t count[6] = { 0 };
+	bool any = false;
+	fprintf(file, "node state    firmware encoding blocks requests seconds   bytes/s\n");
+	for (uint16_t node = 0; node < 256; node++) {
+		const OtaNode* state = &server->nodes[node];
+		if (state->state == OTA_NODE_UNKNOWN) {
+			continue;
+		}
+		count[state->state]++;
+		if (state->state < OTA_NODE_SENDING) {
+			fprintf(file, "%4u %s\n", node, states[state->state]);
+			continue;
+		}
+		const OtaFirmware* firmware = &server->firmwares[state->firmware];
+		uint32_t duration = state->last - state->started;
+		fprintf(file, "%4u %-8s %3u:%-4u %8u %6u %8u %7.1f %9.1f\n", node, states[state->state],
+			firmware->type, firmware->version,
+			state->stream == OTA_SERVER_NO_STREAM ? 0 : server->streams[state->stream].encoding,
+			state->blocks, state->requests, duration / 1000.0,
+			duration ? state->distinct * FIRMWARE_BLOCK_SIZE * 1000.0 / duration : 0.0);
+		if (!any || (int32_t)(state->started - first) < 0) {
+			first = state->started;
+		}
+		if (!any || (int32_t)(state->last - last) > 0) {
+			last = state->last;
+		}
+		any = true;
+		bytes += state->distinct * FIRMWARE_BLOCK_SIZE;
+	}
+	fprintf(file, "%u done, %u failed, %u sending, %u waiting, %u current\n",
+		count[OTA_NODE_DONE], count[OTA_NODE_FAILED], count[OTA_NODE_SENDING], count[OTA_NODE_WAITING],
+		count[OTA_NODE_CURRENT]);
+	if (any) {
+		fprintf(file, "rollout %.1f s, %u bytes, %.1f bytes/s\n", (last - first) / 1000.0, bytes,
+			last != first ? bytes * 1000.0 / (last - first) : 0.0);
+	}
+}
+
+#endif
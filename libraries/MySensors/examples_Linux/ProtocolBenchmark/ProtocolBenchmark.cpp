@@ -0,0 +1,327 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ *******************************
+ *
+ * DESCRIPTION
+ * Host benchmark for the serial protocol of the gateway. Replays controller traffic
+ * (one message per line, controller_traffic.txt is a mix of sets, time/config replies,
+ * id responses and firmware blocks) through protocolParse() and through the former
+ * strtok_r/atoi based parser, checks both give the same messages and reports lines/sec.
+ * The other direction compares protocolFormat() and the MQTT topic builder with the
+ * snprintf based versions they replaced. Finally all messages go through the binary
+ * protocol (MY_GATEWAY_BINARY_PROTOCOL) and back, comparing size and speed with ASCII.
+ *
+ *   g++ -O2 ProtocolBenchmark.cpp -I../.. -I../../drivers/Linux -o ProtocolBenchmark
+ *   ./ProtocolBenchmark controller_traffic.txt
+ */
+
+#define MY_CORE_ONLY
+#define MY_GATEWAY_SERIAL
+#define MY_GATEWAY_BINARY_PROTOCOL
+
+#include <MySensor.h>
+#include <time.h>
+
+#define MAX_LINES 4096
+#define ROUNDS_PER_LINE 2000
+#define TOPIC_PREFIX "mygateway1-out"
+
+static char _lines[MAX_LINES][MY_GATEWAY_MAX_RECEIVE_LENGTH];
+static int _lineCount;
+
+static uint8_t legacyH2i(char c) {
+	uint8_t i = 0;
+	if (c <= '9')
+		i += c - '0';
+	else if (c >= 'a')
+		i += c - 'a' + 10;
+	else
+		i += c - 'A' + 10;
+	return i;
+}
+
+// protocolParse() as it was before the single pass parser
+static bool legacyProtocolParse(MyMessage &message, char *inputString) {
+	char *str, *p, *value=NULL;
+	uint8_t bvalue[MAX_PAYLOAD];
+	uint8_t blen = 0;
+	int i = 0;
+	uint8_t command = 0;
+	uint8_t ack = 0;
+
+	for (str = strtok_r(inputString, ";", &p); str && i < 6; str = strtok_r(NULL, ";", &p)) {
+		switch (i) {
+			case 0:
+				message.destination = atoi(str);
+				break;
+			case 1:
+				message.sensor = atoi(str);
+				break;
+			case 2:
+				command = atoi(str);
+				mSetCommand(message, command);
+				break;
+			case 3:
+				ack = atoi(str);
+				break;
+			case 4:
+				message.type = atoi(str);
+				break;
+			case 5:
+				if (command == C_STREAM) {
+					blen = 0;
+					uint8_t val;
+					while (*str) {
+						val = legacyH2i(*str++) << 4;
+						val += legacyH2i(*str++);
+						bvalue[blen] = val;
+						blen++;
+					}
+				} else {
+					value = str;
+					uint8_t lastCharacter = strlen(value)-1;
+					if (value[lastCharacter] == '\r')
+						value[lastCharacter] = 0;
+					if (value[lastCharacter] == '\n')
+						value[lastCharacter] = 0;
+				}
+				break;
+		}
+		i++;
+	}
+	if (i < 5)
+		return false;
+
+	message.sender = GATEWAY_ADDRESS;
+	message.last = GATEWAY_ADDRESS;
+	mSetRequestAck(message, ack?1:0);
+	mSetAck(message, false);
+	if (command == C_STREAM)
+		message.set(bvalue, blen);
+	else
+		message.set(value);
+	return true;
+}
+
+// protocolFormat() as it was before the dedicated formatter
+static char *legacyProtocolFormat(MyMessage &message) {
+	static char convBuffer[MAX_PAYLOAD*2+1];
+	snprintf_P(_fmtBuffer, MY_GATEWAY_MAX_SEND_LENGTH, PSTR("%d;%d;%d;%d;%d;%s\n"), message.sender, message.sensor, (uint8_t)mGetCommand(message), (uint8_t)mGetAck(message), message.type, message.getString(convBuffer));
+	return _fmtBuffer;
+}
+
+// MQTT topic as built by gatewayTransportSend() in MyGatewayTransportMQTTClient.cpp
+static char *mqttTopic(MyMessage &message) {
+	static const char prefix[] PROGMEM = TOPIC_PREFIX "/";
+	memcpy_P(_fmtBuffer, prefix, sizeof(prefix) - 1);
+	*protocolFormatHeader(_fmtBuffer + sizeof(prefix) - 1, message, '/') = 0;
+	return _fmtBuffer;
+}
+
+static char *legacyMqttTopic(MyMessage &message) {
+	snprintf_P(_fmtBuffer, MY_GATEWAY_MAX_SEND_LENGTH, PSTR(TOPIC_PREFIX "/%d/%d/%d/%d/%d"), message.sender, message.sensor, mGetCommand(message), mGetAck(message), message.type);
+	return _fmtBuffer;
+}
+
+static bool sameMessage(const MyMessage &a, const MyMessage &b) {
+	return !memcmp(&a, &b, HEADER_SIZE) && !memcmp(a.data, b.data, mGetLength(a));
+}
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static MyMessage _messages[MAX_LINES];
+static int _messageCount;
+
+static double benchmarkFormat(char *(*format)(MyMessage &), uint32_t *chars) {
+	*chars = 0;
+	double start = now();
+	for (int round = 0; round < ROUNDS_PER_LINE; round++) {
+		for (int i = 0; i < _messageCount; i++) {
+			*chars += format(_messages[i])[0];
+		}
+	}
+	return (double)_messageCount * ROUNDS_PER_LINE / (now() - start);
+}
+
+static int compareFormat(char *(*format)(MyMessage &), char *(*legacy)(MyMessage &)) {
+	int mismatches = 0;
+	for (int i = 0; i < _messageCount; i++) {
+		char expected[MY_GATEWAY_MAX_SEND_LENGTH];
+		strcpy(expected, legacy(_messages[i]));
+		if (strcmp(expected, format(_messages[i]))) {
+			printf("Format mismatch: %s vs %s", expected, _fmtBuffer);
+			mismatches++;
+		}
+	}
+	return mismatches;
+}
+
+// Binary frame of the message, decoded again. Returns the frame length, 0 if it did not decode.
+static uint8_t binaryRoundTrip(MyMessage &message, MyMessage &decoded) {
+	uint8_t frame[PROTOCOL_BINARY_MAX_FRAME_LENGTH];
+	uint8_t length = protocolFormatBinary(message, frame);
+	// Strip the delimiters as the serial gateway does
+	return protocolParseBinary(decoded, frame + 1, length - 2) ? length : 0;
+}
+
+static double benchmarkBinary(uint32_t *bytes) {
+	MyMessage decoded;
+	*bytes = 0;
+	double start = now();
+	for (int round = 0; round < ROUNDS_PER_LINE; round++) {
+		for (int i = 0; i < _messageCount; i++) {
+			*bytes += binaryRoundTrip(_messages[i], decoded);
+		}
+	}
+	return (double)_messageCount * ROUNDS_PER_LINE / (now() - start);
+}
+
+static double benchmarkAscii(uint32_t *bytes) {
+	MyMessage decoded;
+	*bytes = 0;
+	double start = now();
+	for (int round = 0; round < ROUNDS_PER_LINE; round++) {
+		for (int i = 0; i < _messageCount; i++) {
+			char *line = protocolFormat(_messages[i]);
+			*bytes += strlen(line);
+			protocolParse(decoded, line);
+		}
+	}
+	return (double)_messageCount * ROUNDS_PER_LINE / (now() - start);
+}
+
+static double benchmark(bool (*parse)(MyMessage &, char *), uint32_t *parsed) {
+	char buf[MY_GATEWAY_MAX_RECEIVE_LENGTH];
+	MyMessage msg;
+	*parsed = 0;
+	double start = now();
+	for (int round = 0; round < ROUNDS_PER_LINE; round++) {
+		for (int i = 0; i < _lineCount; i++) {
+			// Both parsers get a fresh copy, the legacy one modifies its input
+			strcpy(buf, _lines[i]);
+			*parsed += parse(msg, buf);
+		}
+	}
+	return (double)_lineCount * ROUNDS_PER_LINE / (now() - start);
+}
+
+int main(int argc, char **argv) {
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s corpus\n", argv[0]);
+		return 1;
+	}
+	FILE *f = fopen(argv[1], "r");
+	if (!f) {
+		fprintf(stderr, "Could not open %s\n", argv[1]);
+		return 1;
+	}
+	while (_lineCount < MAX_LINES && fgets(_lines[_lineCount], MY_GATEWAY_MAX_RECEIVE_LENGTH, f)) {
+		// The serial gateway hands over lines without the newline
+		char *nl = strchr(_lines[_lineCount], '\n');
+		if (nl)
+			*nl = 0;
+		_lineCount++;
+	}
+	fclose(f);
+
+	int mismatches = 0;
+	for (int i = 0; i < _lineCount; i++) {
+		char buf[MY_GATEWAY_MAX_RECEIVE_LENGTH];
+		MyMessage a, b;
+		memset((void *)&a, 0, sizeof(a));
+		memset((void *)&b, 0, sizeof(b));
+		strcpy(buf, _lines[i]);
+		bool okA = protocolParse(a, buf);
+		strcpy(buf, _lines[i]);
+		bool okB = legacyProtocolParse(b, buf);
+		if (okA != okB || (okA && !sameMessage(a, b))) {
+			printf("Mismatch on line %d: %s\n", i + 1, _lines[i]);
+			mismatches++;
+		}
+	}
+
+	uint32_t parsedLegacy, parsedNew;
+	double legacy = benchmark(legacyProtocolParse, &parsedLegacy);
+	double single = benchmark(protocolParse, &parsedNew);
+	printf("%d lines, %d mismatches\n", _lineCount, mismatches);
+	printf("strtok_r/atoi parser: %10.0f lines/s\n", legacy);
+	printf("single pass parser:   %10.0f lines/s (%.1fx)\n", single, single / legacy);
+
+	// Format what the nodes would report: the parsed corpus with sender and
+	// destination swapped plus every numeric payload type
+	for (int i = 0; i < _lineCount && _messageCount < MAX_LINES - 8; i++) {
+		char buf[MY_GATEWAY_MAX_RECEIVE_LENGTH];
+		strcpy(buf, _lines[i]);
+		MyMessage &msg = _messages[_messageCount];
+		if (protocolParse(msg, buf)) {
+			msg.sender = msg.destination;
+			msg.destination = GATEWAY_ADDRESS;
+			mSetAck(msg, i & 1);
+			_messageCount++;
+		}
+		if (i % 50 == 0) {
+			msg = _messages[_messageCount - 1];
+			_messages[_messageCount++] = msg.set((uint8_t)(i & 0xFF));
+			_messages[_messageCount++] = msg.set((int16_t)(-i * 37));
+			_messages[_messageCount++] = msg.set((uint16_t)(i * 101));
+			_messages[_messageCount++] = msg.set((int32_t)(-i * 100003L));
+			_messages[_messageCount++] = msg.set((uint32_t)(i * 1000003UL));
+			_messages[_messageCount++] = msg.set(i / 7.0f, 2);
+		}
+	}
+	int formatMismatches = compareFormat(protocolFormat, legacyProtocolFormat);
+	formatMismatches += compareFormat(mqttTopic, legacyMqttTopic);
+	uint32_t chars;
+	double legacyFormat = benchmarkFormat(legacyProtocolFormat, &chars);
+	double fastFormat = benchmarkFormat(protocolFormat, &chars);
+	double legacyTopic = benchmarkFormat(legacyMqttTopic, &chars);
+	double fastTopic = benchmarkFormat(mqttTopic, &chars);
+	printf("%d messages, %d mismatches\n", _messageCount, formatMismatches);
+	printf("snprintf format:      %10.0f msg/s\n", legacyFormat);
+	printf("protocolFormat:       %10.0f msg/s (%.1fx)\n", fastFormat, fastFormat / legacyFormat);
+	printf("snprintf MQTT topic:  %10.0f msg/s\n", legacyTopic);
+	printf("MQTT topic:           %10.0f msg/s (%.1fx)\n", fastTopic, fastTopic / legacyTopic);
+
+	int binaryMismatches = 0;
+	for (int i = 0; i < _messageCount; i++) {
+		MyMessage expected = _messages[i];
+		MyMessage decoded;
+		expected.sender = GATEWAY_ADDRESS;
+		expected.last = GATEWAY_ADDRESS;
+		mSetAck(expected, false);
+		if (!binaryRoundTrip(_messages[i], decoded) || !sameMessage(expected, decoded)) {
+			printf("Binary mismatch on message %d\n", i);
+			binaryMismatches++;
+		}
+	}
+	uint32_t asciiBytes, binaryBytes;
+	double ascii = benchmarkAscii(&asciiBytes);
+	double binary = benchmarkBinary(&binaryBytes);
+	printf("%d binary round trips, %d mismatches\n", _messageCount, binaryMismatches);
+	// At 115200 baud (10 bits per byte) the serial line, not the CPU, limits the gateway
+	double asciiSize = (double)asciiBytes / _messageCount / ROUNDS_PER_LINE;
+	double binarySize = (double)binaryBytes / _messageCount / ROUNDS_PER_LINE;
+	printf("ASCII format+parse:   %10.0f msg/s, %4.1f bytes/msg, %4.0f msg/s at 115200 baud\n", ascii, asciiSize, 11520 / asciiSize);
+	printf("binary format+parse:  %10.0f msg/s, %4.1f bytes/msg, %4.0f msg/s at 115200 baud\n", binary, binarySize, 11520 / binarySize);
+	return mismatches || formatMismatches || binaryMismatches ? 1 : 0;
+}
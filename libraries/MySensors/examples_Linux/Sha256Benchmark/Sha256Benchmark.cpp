@@ -0,0 +1,331 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ *******************************
+ *
+ * DESCRIPTION
+ * Known answer tests and host benchmark for Sha256Class. The FIPS 180-2 and RFC 4231
+ * vectors are hashed byte by byte, in one block write and in odd sized chunks. The
+ * benchmark compares the byte at a time class as it was before the block API with the
+ * current one, on bulk data and on the soft signer's signature calculation (digest
+ * plus HMAC of one message), which is checked to give the same signature. HMACs are
+ * also checked when restarted from the key blocks cached by Sha256Class::setHmacKey().
+ *
+ *   g++ -O2 Sha256Benchmark.cpp -I../.. -I../../drivers/Linux -o Sha256Benchmark
+ *   ./Sha256Benchmark
+ */
+
+#define MY_CORE_ONLY
+#define MY_SIGNING_SOFT
+
+#include <MySensor.h>
+#include <time.h>
+
+#define BULK_LENGTH 4096
+#define BULK_ROUNDS 2000
+#define SIGN_ROUNDS 100000
+
+// Sha256Class before the block API: one call and one branch per byte
+class LegacySha256 {
+	public:
+		void init(void) {
+			memcpy_P(state.b, sha256InitState, 32);
+			byteCount = 0;
+			bufferOffset = 0;
+		}
+		void write(uint8_t data) {
+			++byteCount;
+			addUncounted(data);
+		}
+		uint8_t* result(void) {
+			addUncounted(0x80);
+			while (bufferOffset != 56) addUncounted(0x00);
+			addUncounted(0);
+			addUncounted(0);
+			addUncounted(0);
+			addUncounted(byteCount >> 29);
+			addUncounted(byteCount >> 21);
+			addUncounted(byteCount >> 13);
+			addUncounted(byteCount >> 5);
+			addUncounted(byteCount << 3);
+			for (int i = 0; i < 8; i++) {
+				uint32_t a = state.w[i];
+				state.w[i] = (a << 24) | ((a << 8) & 0x00ff0000) | ((a >> 8) & 0x0000ff00) | (a >> 24);
+			}
+			return state.b;
+		}
+		void initHmac(const uint8_t* key, int keyLength) {
+			memset(keyBuffer, 0, BLOCK_LENGTH);
+			memcpy(keyBuffer, key, keyLength);
+			init();
+			for (int i = 0; i < BLOCK_LENGTH; i++) write(keyBuffer[i] ^ 0x36);
+		}
+		uint8_t* resultHmac(void) {
+			memcpy(innerHash, result(), HASH_LENGTH);
+			init();
+			for (int i = 0; i < BLOCK_LENGTH; i++) write(keyBuffer[i] ^ 0x5c);
+			for (int i = 0; i < HASH_LENGTH; i++) write(innerHash[i]);
+			return result();
+		}
+	private:
+		uint32_t ror32(uint32_t number, uint8_t bits) {
+			return ((number << (32-bits)) | (number >> bits));
+		}
+		void addUncounted(uint8_t data) {
+			buffer.b[bufferOffset ^ 3] = data;
+			bufferOffset++;
+			if (bufferOffset == BLOCK_LENGTH) {
+				hashBlock();
+				bufferOffset = 0;
+			}
+		}
+		void hashBlock() {
+			uint32_t a,b,c,d,e,f,g,h,t1,t2;
+			a=state.w[0]; b=state.w[1]; c=state.w[2]; d=state.w[3];
+			e=state.w[4]; f=state.w[5]; g=state.w[6]; h=state.w[7];
+			for (uint8_t i=0; i<64; i++) {
+				if (i>=16) {
+					t1 = buffer.w[i&15] + buffer.w[(i-7)&15];
+					t2 = buffer.w[(i-2)&15];
+					t1 += ror32(t2,17) ^ ror32(t2,19) ^ (t2>>10);
+					t2 = buffer.w[(i-15)&15];
+					t1 += ror32(t2,7) ^ ror32(t2,18) ^ (t2>>3);
+					buffer.w[i&15] = t1;
+				}
+				t1 = h;
+				t1 += ror32(e,6) ^ ror32(e,11) ^ ror32(e,25);
+				t1 += g ^ (e & (g ^ f));
+				t1 += pgm_read_dword(sha256K+i);
+				t1 += buffer.w[i&15];
+				t2 = ror32(a,2) ^ ror32(a,13) ^ ror32(a,22);
+				t2 += ((b & c) | (a & (b | c)));
+				h=g; g=f; f=e; e=d+t1; d=c; c=b; b=a; a=t1+t2;
+			}
+			state.w[0] += a; state.w[1] += b; state.w[2] += c; state.w[3] += d;
+			state.w[4] += e; state.w[5] += f; state.w[6] += g; state.w[7] += h;
+		}
+		_buffer buffer;
+		uint8_t bufferOffset;
+		_state state;
+		uint32_t byteCount;
+		uint8_t keyBuffer[BLOCK_LENGTH];
+		uint8_t innerHash[HASH_LENGTH];
+};
+
+// The soft signer's signerCalculateSignature() as it was, on LegacySha256
+static LegacySha256 _legacySha256;
+
+static void legacyCalculateSignature(const uint8_t* message, const uint8_t* nonce, const uint8_t* key,
+	uint8_t* hmac) {
+	uint8_t digest[32];
+	_legacySha256.init();
+	for (int i=0; i<32; i++) _legacySha256.write(message[i]);
+	_legacySha256.write(0x15);
+	_legacySha256.write(0x02);
+	_legacySha256.write(0x08);
+	_legacySha256.write(0x00);
+	_legacySha256.write(0xEE);
+	_legacySha256.write(0x01);
+	_legacySha256.write(0x23);
+	for (int i=0; i<25; i++) _legacySha256.write(0x00);
+	for (int i=0; i<32; i++) _legacySha256.write(nonce[i]);
+	memcpy(digest, _legacySha256.result(), 32);
+
+	_legacySha256.initHmac(key, 32);
+	for (int i=0; i<32; i++) _legacySha256.write(0x00);
+	for (int i=0; i<32; i++) _legacySha256.write(digest[i]);
+	_legacySha256.write(0x11);
+	_legacySha256.write(0x04);
+	_legacySha256.write(0x00);
+	_legacySha256.write(0x00);
+	for (int i=0; i<11; i++) _legacySha256.write(0x00);
+	_legacySha256.write(0xEE);
+	for (int i=0; i<4; i++) _legacySha256.write(0x00);
+	_legacySha256.write(0x01);
+	_legacySha256.write(0x23);
+	for (int i=0; i<2; i++) _legacySha256.write(0x00);
+	memcpy(hmac, _legacySha256.resultHmac(), 32);
+}
+
+typedef struct {
+	const char* name;
+	const char* key;  // NULL for a plain hash
+	int keyLength;
+	const char* data;
+	uint32_t repeat;  // data is hashed this many times
+	const char* digest;
+} kat_t;
+
+static const char _key20[20] = {
+	0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b
+};
+
+static char _key131[131]; // 0xaa, filled in by main()
+
+static const kat_t _kats[] = {
+	{ "empty", NULL, 0, "", 1,
+		"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+	{ "abc", NULL, 0, "abc", 1,
+		"ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+	{ "448 bits", NULL, 0, "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1,
+		"248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+	{ "896 bits", NULL, 0, "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu", 1,
+		"cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1" },
+	{ "million a", NULL, 0, "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa", 10000,
+		"cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0" },
+	{ "RFC 4231 1", _key20, 20, "Hi There", 1,
+		"b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7" },
+	{ "RFC 4231 2", "Jefe", 4, "what do ya want for nothing?", 1,
+		"5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843" },
+	{ "RFC 4231 6", _key131, 131, "Test Using Larger Than Block-Size Key - Hash Key First", 1,
+		"60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54" },
+};
+
+static volatile uint8_t _sink; // Keeps the benchmark loops from being optimized away
+
+// How the data goes in: byte by byte, in one write per repeat or in odd sized chunks
+enum { FEED_BYTES, FEED_BLOCK, FEED_CHUNKS };
+
+static void feed(Sha256Class &sha, const uint8_t* data, size_t length, int mode) {
+	if (mode == FEED_BYTES) {
+		for (size_t i = 0; i < length; i++) {
+			sha.write(data[i]);
+		}
+	} else if (mode == FEED_BLOCK) {
+		sha.write(data, length);
+	} else {
+		static const size_t chunks[] = { 1, 3, 63, 64, 65, 7, 128, 31 };
+		for (size_t i = 0, c = 0; i < length; c++) {
+			size_t n = chunks[c % 8] < length - i ? chunks[c % 8] : length - i;
+			sha.write(data + i, n);
+			i += n;
+		}
+	}
+}
+
+static void hex(const uint8_t* data, char* out) {
+	for (int i = 0; i < 32; i++) {
+		sprintf(out + 2 * i, "%02x", data[i]);
+	}
+}
+
+static int runKats(void) {
+	static const char* modes[] = { "bytes", "block", "chunks" };
+	int tests = 0;
+	int failures = 0;
+	for (size_t k = 0; k < sizeof(_kats) / sizeof(_kats[0]); k++) {
+		const kat_t &kat = _kats[k];
+		for (int mode = FEED_BYTES; mode <= FEED_CHUNKS; mode++) {
+			Sha256Class sha;
+			// An HMAC is also repeated from the cached key blocks
+			for (int pass = 0; pass < (kat.key ? 2 : 1); pass++) {
+				if (!kat.key) {
+					sha.init();
+				} else if (!pass) {
+					sha.initHmac((const uint8_t*)kat.key, kat.keyLength);
+				} else {
+					sha.initHmac();
+				}
+				for (uint32_t r = 0; r < kat.repeat; r++) {
+					feed(sha, (const uint8_t*)kat.data, strlen(kat.data), mode);
+				}
+				char out[65];
+				hex(kat.key ? sha.resultHmac() : sha.result(), out);
+				if (strcmp(out, kat.digest)) {
+					printf("FAIL %-12s %-6s%s %s\n", kat.name, modes[mode], pass ? " cached" : "", out);
+					failures++;
+				}
+				tests++;
+			}
+		}
+	}
+	printf("%d known answer tests, %d failures\n", tests, failures);
+	return failures;
+}
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void) {
+	memset(_key131, 0xaa, sizeof(_key131));
+	int failures = runKats();
+
+	static uint8_t data[BULK_LENGTH];
+	for (int i = 0; i < BULK_LENGTH; i++) {
+		data[i] = i * 7 + 3;
+	}
+	double start = now();
+	for (int r = 0; r < BULK_ROUNDS; r++) {
+		_legacySha256.init();
+		for (int i = 0; i < BULK_LENGTH; i++) {
+			_legacySha256.write(data[i]);
+		}
+		_sink += _legacySha256.result()[0];
+	}
+	double legacy = BULK_LENGTH * (double)BULK_ROUNDS / (now() - start) / 1e6;
+	start = now();
+	for (int r = 0; r < BULK_ROUNDS; r++) {
+		_signing_sha256.init();
+		_signing_sha256.write(data, BULK_LENGTH);
+		_sink += _signing_sha256.result()[0];
+	}
+	double block = BULK_LENGTH * (double)BULK_ROUNDS / (now() - start) / 1e6;
+	printf("byte writes:           %8.1f MB/s\n", legacy);
+	printf("block writes:          %8.1f MB/s (%.1fx)\n", block, block / legacy);
+
+	// Signature of one message with the soft signer, against the former implementation
+	uint8_t key[32];
+	for (int i = 0; i < 32; i++) {
+		key[i] = i * 13 + 1;
+	}
+	_signing_sha256.setHmacKey(key, 32); // As signerAtsha204SoftInit() does
+	MyMessage msg;
+	msg.set((uint8_t*)"signing benchmark", 17);
+	uint8_t message[32], nonce[32], expected[32];
+	memset(message, 0, 32);
+	memcpy(message, (uint8_t*)&msg.data[1-HEADER_SIZE], MAX_MESSAGE_LENGTH-1-(MAX_PAYLOAD-mGetLength(msg)));
+	memset(nonce, 0x5A, 32);
+	memcpy(_signing_current_nonce, nonce, 32);
+	signerCalculateSignature(msg);
+	legacyCalculateSignature(message, nonce, key, expected);
+	if (memcmp(expected, _signing_hmac, 32)) {
+		printf("FAIL signature differs from the byte at a time calculation\n");
+		failures++;
+	}
+
+	start = now();
+	for (int r = 0; r < SIGN_ROUNDS; r++) {
+		nonce[0] = r;
+		legacyCalculateSignature(message, nonce, key, expected);
+		_sink += expected[0];
+	}
+	legacy = SIGN_ROUNDS / (now() - start);
+	start = now();
+	for (int r = 0; r < SIGN_ROUNDS; r++) {
+		_signing_current_nonce[0] = r;
+		signerCalculateSignature(msg);
+		_sink += _signing_hmac[0];
+	}
+	block = SIGN_ROUNDS / (now() - start);
+	printf("signatures, former:    %8.0f /s\n", legacy);
+	printf("signatures, current:   %8.0f /s (%.1fx)\n", block, block / legacy);
+	return failures ? 1 : 0;
+}